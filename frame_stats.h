@@ -0,0 +1,210 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+/*
+	Where the main loop's time goes, phase by phase.
+
+	frame_phase() charges the time since the previous mark to a phase, so a phase that is
+	skipped costs nothing and one that runs twice adds up; iterations that end up drawing
+	nothing roll into the next frame that does. frame_stats_end() closes the frame with
+	the polygons and geometry calls it issued.
+
+	The last FRAME_STATS_WINDOW frames give the rolling p50/p99 of the overlay drawn by
+	frame_stats_draw(), in a built-in 3x5 pixel font since SDL has no text of its own.
+	With a trace file, every frame is also written as a CSV row.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <SDL.h>
+
+#define FRAME_STATS_WINDOW 240
+
+enum {
+	PHASE_BUILD,   // taking polygons from the background build
+	PHASE_IDLE,    // blocked waiting for events
+	PHASE_EVENTS,
+	PHASE_FIELD,   // quad_factor update
+	PHASE_COLORS,
+	PHASE_RENDER,  // geometry submission, or the software rasterizer
+	PHASE_CAPTURE,
+	PHASE_COPY,    // AAtexture onto the window, palette, overlay
+	PHASE_PRESENT,
+	PHASE_DELAY,   // SDL_framerateDelay
+	FRAME_PHASES
+};
+
+static const char *frame_phase_names [FRAME_PHASES] = {
+	"build", "idle", "events", "field", "colors", "render", "capture", "copy", "present", "delay"
+};
+
+typedef struct {
+
+	Uint64 last;                 // performance counter at the previous mark
+	double freq;
+	double now [FRAME_PHASES];   // seconds, this frame so far
+	int polygons;                // this frame, added up by the caller
+	int calls;
+
+	// ms per phase, then the whole frame less idle time
+	float hist [FRAME_PHASES+1][FRAME_STATS_WINDOW];
+	int hist_polygons, hist_calls; // of the last frame
+	int head, filled;
+	int frames;
+	Uint64 t0;
+
+	float p50 [FRAME_PHASES+1], p99 [FRAME_PHASES+1];
+	Uint64 shown_at;
+	bool hud;
+
+	FILE *csv;
+	char tags [256]; // constant trailing CSV columns
+
+} frame_stats;
+
+static void frame_stats_init( frame_stats *FS ){
+	memset( FS, 0, sizeof(frame_stats) );
+	FS->freq = (double) SDL_GetPerformanceFrequency();
+	FS->t0 = SDL_GetPerformanceCounter();
+	FS->last = FS->t0;
+}
+
+// CSV rows for every frame from now on, tagged with the tesselation and anti-aliasing settings.
+static int frame_stats_trace( frame_stats *FS, const char *path, const char *tesselation, int AAx, int aa_mode ){
+	FS->csv = fopen( path, "w" );
+	if( FS->csv == NULL ) return 0;
+	fputs( "frame,time_s", FS->csv );
+	for (int p = 0; p < FRAME_PHASES; ++p ) fprintf( FS->csv, ",%s_ms", frame_phase_names[p] );
+	fputs( ",frame_ms,polygons,geometry_calls,tesselation,AA_Level,AA_mode\n", FS->csv );
+	// the name is quoted, quotes doubled
+	int n = 0;
+	FS->tags[ n++ ] = '"';
+	for (const char *c = tesselation; *c != '\0' && n < 200; ++c ){
+		if( *c == '"' ) FS->tags[ n++ ] = '"';
+		FS->tags[ n++ ] = *c;
+	}
+	snprintf( FS->tags + n, sizeof(FS->tags) - n, "\",%d,%d", AAx, aa_mode );
+	return 1;
+}
+
+static void frame_phase( frame_stats *FS, int phase ){
+	Uint64 t = SDL_GetPerformanceCounter();
+	FS->now[ phase ] += (t - FS->last) / FS->freq;
+	FS->last = t;
+}
+
+static void frame_stats_end( frame_stats *FS ){
+	double total = 0;
+	for (int p = 0; p < FRAME_PHASES; ++p ){
+		FS->hist[p][ FS->head ] = 1000 * FS->now[p];
+		if( p != PHASE_IDLE ) total += FS->now[p];
+	}
+	FS->hist[ FRAME_PHASES ][ FS->head ] = 1000 * total;
+	FS->head = (FS->head + 1) % FRAME_STATS_WINDOW;
+	if( FS->filled < FRAME_STATS_WINDOW ) FS->filled++;
+	FS->hist_polygons = FS->polygons;
+	FS->hist_calls = FS->calls;
+
+	if( FS->csv != NULL ){
+		fprintf( FS->csv, "%d,%.4f", FS->frames, (FS->last - FS->t0) / FS->freq );
+		for (int p = 0; p < FRAME_PHASES; ++p ) fprintf( FS->csv, ",%.4f", 1000 * FS->now[p] );
+		fprintf( FS->csv, ",%.4f,%d,%d,%s\n", 1000 * total, FS->polygons, FS->calls, FS->tags );
+	}
+
+	FS->frames++;
+	memset( FS->now, 0, sizeof(FS->now) );
+	FS->polygons = 0;
+	FS->calls = 0;
+}
+
+static int frame_stats_cmp( const void *a, const void *b ){
+	float x = *(const float*)a, y = *(const float*)b;
+	return (x > y) - (x < y);
+}
+
+static void frame_stats_percentiles( frame_stats *FS ){
+	float sorted [FRAME_STATS_WINDOW];
+	int n = FS->filled;
+	if( n == 0 ) return;
+	for (int p = 0; p <= FRAME_PHASES; ++p ){
+		memcpy( sorted, FS->hist[p], n * sizeof(float) );
+		qsort( sorted, n, sizeof(float), frame_stats_cmp );
+		FS->p50[p] = sorted[ (n - 1) / 2 ];
+		FS->p99[p] = sorted[ (99 * (n - 1)) / 100 ];
+	}
+}
+
+static Uint16 hud_glyph( char c ){
+	static const Uint16 digits [10] = { 0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF, 0x79EF, 0x7249, 0x7BEF, 0x7BCF };
+	static const Uint16 letters [26] = { 0x2BED, 0x6BAE, 0x3923, 0x6B6E, 0x79A7, 0x79A4, 0x396B, 0x5BED, 0x7497, 0x126A, 0x5BAD, 0x4927, 0x5FED,
+	                                     0x6B6D, 0x2B6A, 0x6BA4, 0x2B73, 0x6BAD, 0x388E, 0x7492, 0x5B6F, 0x5B6A, 0x5BFD, 0x5AAD, 0x5A92, 0x72A7 };
+	if( c >= '0' && c <= '9' ) return digits[ c - '0' ];
+	if( c >= 'a' && c <= 'z' ) c -= 'a' - 'A';
+	if( c >= 'A' && c <= 'Z' ) return letters[ c - 'A' ];
+	switch( c ){
+		case '.': return 0x0002;
+		case ':': return 0x0410;
+		case '/': return 0x12A4;
+		case '-': return 0x01C0;
+	}
+	return 0;
+}
+
+// One line of text, each font pixel a px x px square. Returns the width drawn.
+static int hud_text( SDL_Renderer *R, int x, int y, int px, const char *s ){
+	SDL_Rect rects [15 * 64];
+	int n = 0, cx = x;
+	for (; *s != '\0' && n <= 15 * 63; ++s ){
+		Uint16 g = hud_glyph( *s );
+		for (int b = 0; b < 15; ++b ){
+			if( g & (1 << (14 - b)) ){
+				rects[ n++ ] = (SDL_Rect){ cx + px * (b % 3), y + px * (b / 3), px, px };
+			}
+		}
+		cx += 4 * px;
+	}
+	if( n > 0 ) SDL_RenderFillRects( R, rects, n );
+	return cx - x;
+}
+
+// The overlay, at x, y with font pixels of px. Percentiles are refreshed 4 times a second to stay readable.
+static void frame_stats_draw( frame_stats *FS, SDL_Renderer *R, int x, int y, int px ){
+	Uint64 t = SDL_GetPerformanceCounter();
+	if( FS->shown_at == 0 || (t - FS->shown_at) / FS->freq > 0.25 ){
+		frame_stats_percentiles( FS );
+		FS->shown_at = t;
+	}
+	int line = 7 * px;
+	int col = 4 * px;
+	SDL_Rect bg = { x, y, 25 * col + 2 * px, (FRAME_PHASES + 3) * line + px };
+	SDL_SetRenderDrawColor( R, 0, 0, 0, 176 );
+	SDL_RenderFillRect( R, &bg );
+	SDL_SetRenderDrawColor( R, 255, 255, 255, 255 );
+
+	char buf [64];
+	x += px;
+	y += px;
+	hud_text( R, x, y, px, "ms" );
+	hud_text( R, x + 12 * col, y, px, "p50" );
+	hud_text( R, x + 20 * col, y, px, "p99" );
+	for (int p = 0; p <= FRAME_PHASES; ++p ){
+		y += line;
+		hud_text( R, x, y, px, (p < FRAME_PHASES)? frame_phase_names[p] : "frame" );
+		snprintf( buf, 64, "%7.2f", FS->p50[p] );
+		hud_text( R, x + 8 * col, y, px, buf );
+		snprintf( buf, 64, "%7.2f", FS->p99[p] );
+		hud_text( R, x + 16 * col, y, px, buf );
+	}
+	y += line;
+	snprintf( buf, 64, "polys %d calls %d", FS->hist_polygons, FS->hist_calls );
+	hud_text( R, x, y, px, buf );
+}
+
+static void frame_stats_close( frame_stats *FS ){
+	if( FS->csv != NULL ) fclose( FS->csv );
+	FS->csv = NULL;
+}
+
+#endif
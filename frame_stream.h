@@ -0,0 +1,154 @@
+#ifndef FRAME_STREAM_H
+#define FRAME_STREAM_H
+
+/*
+	Streams RGBA frames to a file, or to stdout ("-") for piping into an encoder, as raw
+	RGBA or as YUV4MPEG2 (4:4:4, BT.601 limited range), from a writer thread.
+
+	There are two frame buffers: frame_stream_acquire() waits for a free one, the caller
+	fills it with width x height RGBA pixels (rows of 4 * width bytes, no padding) and
+	frame_stream_submit() hands it to the writer, so the next frame can be read back while
+	the previous one is converted and written. Frames are never dropped; a slow consumer
+	slows the caller down instead.
+
+	When writing to stdout, stdout itself is pointed at stderr so log output can't end up
+	in the stream.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#ifdef _WIN32
+	#include <io.h>
+	#include <fcntl.h>
+	#define fs_dup _dup
+	#define fs_dup2 _dup2
+	#define fs_fdopen _fdopen
+#else
+	#include <unistd.h>
+	#define fs_dup dup
+	#define fs_dup2 dup2
+	#define fs_fdopen fdopen
+#endif
+
+typedef struct {
+
+	FILE *f;
+	int y4m;
+	int width, height, fps;
+
+	Uint8 *buf [2];
+	Uint8 *plane; // the writer's Y, U, V planes
+	SDL_sem *free_bufs;
+	SDL_sem *full_bufs;
+	int fill, drain; // next buffer for the caller / the writer
+	int quit;
+	SDL_Thread *thread;
+
+	int frames;
+	int ok;
+
+} frame_stream;
+
+static void frame_stream_write( frame_stream *FS, const Uint8 *rgba ){
+	int n = FS->width * FS->height;
+	if( !FS->y4m ){
+		FS->ok &= ( fwrite( rgba, 4, n, FS->f ) == (size_t)n );
+		return;
+	}
+	Uint8 *Y = FS->plane, *U = Y + n, *V = U + n;
+	for (int i = 0; i < n; ++i ){
+		int r = rgba[4*i], g = rgba[4*i+1], b = rgba[4*i+2];
+		Y[i] = (( 66 * r + 129 * g +  25 * b + 128) >> 8) + 16;
+		U[i] = ((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128;
+		V[i] = ((112 * r -  94 * g -  18 * b + 128) >> 8) + 128;
+	}
+	FS->ok &= ( fputs( "FRAME\n", FS->f ) >= 0 );
+	FS->ok &= ( fwrite( FS->plane, 1, 3 * n, FS->f ) == (size_t)(3 * n) );
+}
+
+static int frame_stream_thread( void *data ){
+	frame_stream *FS = data;
+	while( 1 ){
+		SDL_SemWait( FS->full_bufs );
+		if( FS->quit ) break;
+		frame_stream_write( FS, FS->buf[ FS->drain ] );
+		FS->drain = 1 - FS->drain;
+		FS->frames++;
+		SDL_SemPost( FS->free_bufs );
+	}
+	return 0;
+}
+
+// path "-" is stdout. Returns 0 if the file or the thread couldn't be made.
+static int frame_stream_open( frame_stream *FS, const char *path, int width, int height, int fps, int y4m ){
+	memset( FS, 0, sizeof(frame_stream) );
+	if( strcmp( path, "-" ) == 0 ){
+		fflush( stdout );
+		int fd = fs_dup( 1 );
+		fs_dup2( 2, 1 );
+		FS->f = (fd >= 0)? fs_fdopen( fd, "wb" ) : NULL;
+#ifdef _WIN32
+		if( FS->f != NULL ) _setmode( fd, _O_BINARY );
+#endif
+	}
+	else FS->f = fopen( path, "wb" );
+	if( FS->f == NULL ) return 0;
+
+	FS->y4m = y4m;
+	FS->width = width;
+	FS->height = height;
+	FS->fps = fps;
+	FS->ok = 1;
+	for (int i = 0; i < 2; ++i ) FS->buf[i] = malloc( 4 * width * height );
+	if( y4m ){
+		FS->plane = malloc( 3 * width * height );
+		FS->ok &= ( fprintf( FS->f, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, fps ) > 0 );
+	}
+	FS->free_bufs = SDL_CreateSemaphore( 2 );
+	FS->full_bufs = SDL_CreateSemaphore( 0 );
+	FS->thread = SDL_CreateThread( frame_stream_thread, "frame writer", FS );
+	if( FS->thread == NULL ){
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread error: %s", SDL_GetError() );
+		return 0;
+	}
+	return FS->ok;
+}
+
+// A buffer for the next frame, once the writer is done with it.
+static Uint8 *frame_stream_acquire( frame_stream *FS ){
+	SDL_SemWait( FS->free_bufs );
+	return FS->buf[ FS->fill ];
+}
+
+static void frame_stream_submit( frame_stream *FS ){
+	FS->fill = 1 - FS->fill;
+	SDL_SemPost( FS->full_bufs );
+}
+
+// Writes out what was submitted and closes the file. Returns 0 if any write failed.
+static int frame_stream_close( frame_stream *FS ){
+	if( FS->thread != NULL ){
+		// both buffers free means the writer is idle
+		SDL_SemWait( FS->free_bufs );
+		SDL_SemWait( FS->free_bufs );
+		FS->quit = 1;
+		SDL_SemPost( FS->full_bufs );
+		SDL_WaitThread( FS->thread, NULL );
+	}
+	if( FS->free_bufs != NULL ) SDL_DestroySemaphore( FS->free_bufs );
+	if( FS->full_bufs != NULL ) SDL_DestroySemaphore( FS->full_bufs );
+	if( FS->f != NULL ) FS->ok &= ( fclose( FS->f ) == 0 );
+	for (int i = 0; i < 2; ++i ) free( FS->buf[i] );
+	free( FS->plane );
+	memset( FS->buf, 0, sizeof(FS->buf) );
+	FS->plane = NULL;
+	FS->free_bufs = NULL;
+	FS->full_bufs = NULL;
+	FS->thread = NULL;
+	FS->f = NULL;
+	return FS->ok;
+}
+
+#endif
@@ -0,0 +1,320 @@
+#ifndef OPEN_SIMPLEX_NOISE_BATCH_H__
+#define OPEN_SIMPLEX_NOISE_BATCH_H__
+
+/*
+ * Batch evaluation of 2D OpenSimplex noise over arrays of points.
+ *
+ * This is a port of the 2D path of the C open-simplex-noise reference
+ * (open_simplex_noise() seeding + open_simplex_noise2()), with its own copy of
+ * the permutation table so lanes can gather from it. The region branches are
+ * turned into masks, and every lane performs the same IEEE double operations
+ * in the same order as the scalar code, so results are bit-identical to it as
+ * long as neither side gets its multiply-adds contracted into FMA. When they
+ * are, the difference stays far below OSN_BATCH_TOLERANCE, which is what
+ * open_simplex_noise_batch_check() verifies against the scalar library.
+ *
+ * Lanes: AVX2 (4 doubles, perm/gradient lookups via gathers), picked at
+ * runtime; scalar elsewhere and for the tails.
+ */
+
+#include <stdint.h>
+#include <math.h>
+#include "open-simplex-noise.h"
+
+#define OSN_BATCH_TOLERANCE 1e-9
+
+#define OSN_STRETCH_CONSTANT_2D (-0.211324865405187)
+#define OSN_SQUISH_CONSTANT_2D  (0.366025403784439)
+#define OSN_NORM_CONSTANT_2D    (47.0)
+
+struct osn_batch_context {
+	int32_t perm [256];
+	double grad_x [16];
+	double grad_y [16];
+	int use_avx2;
+};
+
+static const int8_t osn_batch_gradients2D [16] = {
+	 5,  2,    2,  5,
+	-5,  2,   -2,  5,
+	 5, -2,    2, -5,
+	-5, -2,   -2, -5,
+};
+
+static void open_simplex_noise_batch_init( int64_t seed, struct osn_batch_context *ctx ){
+	int16_t source [256];
+	for (int i = 0; i < 256; i++) source[i] = (int16_t) i;
+	seed = seed * 6364136223846793005LL + 1442695040888963407LL;
+	seed = seed * 6364136223846793005LL + 1442695040888963407LL;
+	seed = seed * 6364136223846793005LL + 1442695040888963407LL;
+	for (int i = 255; i >= 0; i--) {
+		seed = seed * 6364136223846793005LL + 1442695040888963407LL;
+		int r = (int)((seed + 31) % (i + 1));
+		if (r < 0) r += (i + 1);
+		ctx->perm[i] = source[r];
+		source[r] = source[i];
+	}
+	// extrapolate2() only ever reads even indices (perm & 0x0E)
+	for (int i = 0; i < 16; i += 2) {
+		ctx->grad_x[i] = osn_batch_gradients2D[i];
+		ctx->grad_y[i] = osn_batch_gradients2D[i + 1];
+		ctx->grad_x[i + 1] = 0;
+		ctx->grad_y[i + 1] = 0;
+	}
+	#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	ctx->use_avx2 = __builtin_cpu_supports("avx2");
+	#else
+	ctx->use_avx2 = 0;
+	#endif
+}
+
+static inline int osn_batch_fast_floor( double x ){
+	int xi = (int) x;
+	return x < xi ? xi - 1 : xi;
+}
+
+static inline double osn_batch_extrapolate2( const struct osn_batch_context *ctx, int xsb, int ysb, double dx, double dy ){
+	int index = ctx->perm[ (ctx->perm[ xsb & 0xFF ] + ysb) & 0xFF ] & 0x0E;
+	return ctx->grad_x[index] * dx + ctx->grad_y[index] * dy;
+}
+
+// scalar reference, same math as open_simplex_noise2()
+static double open_simplex_noise2d_ref( const struct osn_batch_context *ctx, double x, double y ){
+
+	double stretchOffset = (x + y) * OSN_STRETCH_CONSTANT_2D;
+	double xs = x + stretchOffset;
+	double ys = y + stretchOffset;
+	int xsb = osn_batch_fast_floor(xs);
+	int ysb = osn_batch_fast_floor(ys);
+	double squishOffset = (xsb + ysb) * OSN_SQUISH_CONSTANT_2D;
+	double xb = xsb + squishOffset;
+	double yb = ysb + squishOffset;
+	double xins = xs - xsb;
+	double yins = ys - ysb;
+	double inSum = xins + yins;
+	double dx0 = x - xb;
+	double dy0 = y - yb;
+	double dx_ext, dy_ext;
+	int xsv_ext, ysv_ext;
+	double value = 0;
+
+	// Contribution (1,0)
+	double dx1 = dx0 - 1 - OSN_SQUISH_CONSTANT_2D;
+	double dy1 = dy0 - 0 - OSN_SQUISH_CONSTANT_2D;
+	double attn1 = 2 - dx1 * dx1 - dy1 * dy1;
+	if (attn1 > 0) {
+		attn1 *= attn1;
+		value += attn1 * attn1 * osn_batch_extrapolate2(ctx, xsb + 1, ysb + 0, dx1, dy1);
+	}
+
+	// Contribution (0,1)
+	double dx2 = dx0 - 0 - OSN_SQUISH_CONSTANT_2D;
+	double dy2 = dy0 - 1 - OSN_SQUISH_CONSTANT_2D;
+	double attn2 = 2 - dx2 * dx2 - dy2 * dy2;
+	if (attn2 > 0) {
+		attn2 *= attn2;
+		value += attn2 * attn2 * osn_batch_extrapolate2(ctx, xsb + 0, ysb + 1, dx2, dy2);
+	}
+
+	if (inSum <= 1) {
+		double zins = 1 - inSum;
+		if (zins > xins || zins > yins) {
+			if (xins > yins) {
+				xsv_ext = xsb + 1;  ysv_ext = ysb - 1;
+				dx_ext = dx0 - 1;   dy_ext = dy0 + 1;
+			} else {
+				xsv_ext = xsb - 1;  ysv_ext = ysb + 1;
+				dx_ext = dx0 + 1;   dy_ext = dy0 - 1;
+			}
+		} else {
+			xsv_ext = xsb + 1;  ysv_ext = ysb + 1;
+			dx_ext = dx0 - 1 - 2 * OSN_SQUISH_CONSTANT_2D;
+			dy_ext = dy0 - 1 - 2 * OSN_SQUISH_CONSTANT_2D;
+		}
+	} else {
+		double zins = 2 - inSum;
+		if (zins < xins || zins < yins) {
+			if (xins > yins) {
+				xsv_ext = xsb + 2;  ysv_ext = ysb + 0;
+				dx_ext = dx0 - 2 - 2 * OSN_SQUISH_CONSTANT_2D;
+				dy_ext = dy0 + 0 - 2 * OSN_SQUISH_CONSTANT_2D;
+			} else {
+				xsv_ext = xsb + 0;  ysv_ext = ysb + 2;
+				dx_ext = dx0 + 0 - 2 * OSN_SQUISH_CONSTANT_2D;
+				dy_ext = dy0 - 2 - 2 * OSN_SQUISH_CONSTANT_2D;
+			}
+		} else {
+			dx_ext = dx0;  dy_ext = dy0;
+			xsv_ext = xsb; ysv_ext = ysb;
+		}
+		xsb += 1;
+		ysb += 1;
+		dx0 = dx0 - 1 - 2 * OSN_SQUISH_CONSTANT_2D;
+		dy0 = dy0 - 1 - 2 * OSN_SQUISH_CONSTANT_2D;
+	}
+
+	// Contribution (0,0) or (1,1)
+	double attn0 = 2 - dx0 * dx0 - dy0 * dy0;
+	if (attn0 > 0) {
+		attn0 *= attn0;
+		value += attn0 * attn0 * osn_batch_extrapolate2(ctx, xsb, ysb, dx0, dy0);
+	}
+
+	// Extra Vertex
+	double attn_ext = 2 - dx_ext * dx_ext - dy_ext * dy_ext;
+	if (attn_ext > 0) {
+		attn_ext *= attn_ext;
+		value += attn_ext * attn_ext * osn_batch_extrapolate2(ctx, xsv_ext, ysv_ext, dx_ext, dy_ext);
+	}
+
+	return value / OSN_NORM_CONSTANT_2D;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define OSN_BATCH_HAVE_AVX2 1
+
+#define OSN_TGT __attribute__((target("avx2")))
+
+// one gathered contribution: attn > 0 ? attn^4 * <grad, d> : 0.
+// xsb/ysb are exact integers carried in doubles.
+OSN_TGT static inline __m256d osn_batch_contrib4( const struct osn_batch_context *ctx, __m256d xsb, __m256d ysb, __m256d dx, __m256d dy ){
+	const __m256d two = _mm256_set1_pd( 2 );
+	__m256d attn = _mm256_sub_pd( _mm256_sub_pd( two, _mm256_mul_pd( dx, dx ) ), _mm256_mul_pd( dy, dy ) );
+	__m256d live = _mm256_cmp_pd( attn, _mm256_setzero_pd(), _CMP_GT_OQ );
+	__m128i ix = _mm_and_si128( _mm256_cvtpd_epi32( xsb ), _mm_set1_epi32( 0xFF ) );
+	__m128i iy = _mm256_cvtpd_epi32( ysb );
+	__m128i p0 = _mm_i32gather_epi32( ctx->perm, ix, 4 );
+	__m128i p1 = _mm_i32gather_epi32( ctx->perm, _mm_and_si128( _mm_add_epi32( p0, iy ), _mm_set1_epi32( 0xFF ) ), 4 );
+	__m128i gi = _mm_and_si128( p1, _mm_set1_epi32( 0x0E ) );
+	__m256d gx = _mm256_i32gather_pd( ctx->grad_x, gi, 8 );
+	__m256d gy = _mm256_i32gather_pd( ctx->grad_y, gi, 8 );
+	__m256d ext = _mm256_add_pd( _mm256_mul_pd( gx, dx ), _mm256_mul_pd( gy, dy ) );
+	attn = _mm256_mul_pd( attn, attn );
+	return _mm256_and_pd( live, _mm256_mul_pd( _mm256_mul_pd( attn, attn ), ext ) );
+}
+
+OSN_TGT static __m256d osn_batch_noise4( const struct osn_batch_context *ctx, __m256d x, __m256d y ){
+
+	const __m256d SQ  = _mm256_set1_pd( OSN_SQUISH_CONSTANT_2D );
+	const __m256d SQ2 = _mm256_set1_pd( 2 * OSN_SQUISH_CONSTANT_2D );
+	const __m256d one = _mm256_set1_pd( 1 );
+	const __m256d two = _mm256_set1_pd( 2 );
+
+	__m256d stretch = _mm256_mul_pd( _mm256_add_pd( x, y ), _mm256_set1_pd( OSN_STRETCH_CONSTANT_2D ) );
+	__m256d xs = _mm256_add_pd( x, stretch );
+	__m256d ys = _mm256_add_pd( y, stretch );
+	__m256d xsb = _mm256_floor_pd( xs );
+	__m256d ysb = _mm256_floor_pd( ys );
+	__m256d squish = _mm256_mul_pd( _mm256_add_pd( xsb, ysb ), SQ );
+	__m256d xins = _mm256_sub_pd( xs, xsb );
+	__m256d yins = _mm256_sub_pd( ys, ysb );
+	__m256d inSum = _mm256_add_pd( xins, yins );
+	__m256d dx0 = _mm256_sub_pd( x, _mm256_add_pd( xsb, squish ) );
+	__m256d dy0 = _mm256_sub_pd( y, _mm256_add_pd( ysb, squish ) );
+
+	// (1,0) and (0,1)
+	__m256d value = osn_batch_contrib4( ctx, _mm256_add_pd( xsb, one ), ysb,
+										_mm256_sub_pd( _mm256_sub_pd( dx0, one ), SQ ), _mm256_sub_pd( dy0, SQ ) );
+	value = _mm256_add_pd( value, osn_batch_contrib4( ctx, xsb, _mm256_add_pd( ysb, one ),
+										_mm256_sub_pd( dx0, SQ ), _mm256_sub_pd( _mm256_sub_pd( dy0, one ), SQ ) ) );
+
+	__m256d lower = _mm256_cmp_pd( inSum, one, _CMP_LE_OQ );
+	__m256d xgty  = _mm256_cmp_pd( xins, yins, _CMP_GT_OQ );
+
+	// inSum <= 1: triangle at (0,0)
+	__m256d zl = _mm256_sub_pd( one, inSum );
+	__m256d near_l = _mm256_or_pd( _mm256_cmp_pd( zl, xins, _CMP_GT_OQ ), _mm256_cmp_pd( zl, yins, _CMP_GT_OQ ) );
+	__m256d lx  = _mm256_blendv_pd( _mm256_sub_pd( xsb, one ), _mm256_add_pd( xsb, one ), xgty );
+	__m256d ly  = _mm256_blendv_pd( _mm256_add_pd( ysb, one ), _mm256_sub_pd( ysb, one ), xgty );
+	__m256d ldx = _mm256_blendv_pd( _mm256_add_pd( dx0, one ), _mm256_sub_pd( dx0, one ), xgty );
+	__m256d ldy = _mm256_blendv_pd( _mm256_sub_pd( dy0, one ), _mm256_add_pd( dy0, one ), xgty );
+	lx  = _mm256_blendv_pd( _mm256_add_pd( xsb, one ), lx, near_l );
+	ly  = _mm256_blendv_pd( _mm256_add_pd( ysb, one ), ly, near_l );
+	ldx = _mm256_blendv_pd( _mm256_sub_pd( _mm256_sub_pd( dx0, one ), SQ2 ), ldx, near_l );
+	ldy = _mm256_blendv_pd( _mm256_sub_pd( _mm256_sub_pd( dy0, one ), SQ2 ), ldy, near_l );
+
+	// inSum > 1: triangle at (1,1)
+	__m256d zu = _mm256_sub_pd( two, inSum );
+	__m256d near_u = _mm256_or_pd( _mm256_cmp_pd( zu, xins, _CMP_LT_OQ ), _mm256_cmp_pd( zu, yins, _CMP_LT_OQ ) );
+	__m256d ux  = _mm256_blendv_pd( xsb, _mm256_add_pd( xsb, two ), xgty );
+	__m256d uy  = _mm256_blendv_pd( _mm256_add_pd( ysb, two ), ysb, xgty );
+	__m256d udx = _mm256_blendv_pd( _mm256_sub_pd( _mm256_add_pd( dx0, _mm256_setzero_pd() ), SQ2 ),
+									_mm256_sub_pd( _mm256_sub_pd( dx0, two ), SQ2 ), xgty );
+	__m256d udy = _mm256_blendv_pd( _mm256_sub_pd( _mm256_sub_pd( dy0, two ), SQ2 ),
+									_mm256_sub_pd( _mm256_add_pd( dy0, _mm256_setzero_pd() ), SQ2 ), xgty );
+	ux  = _mm256_blendv_pd( xsb, ux, near_u );
+	uy  = _mm256_blendv_pd( ysb, uy, near_u );
+	udx = _mm256_blendv_pd( dx0, udx, near_u );
+	udy = _mm256_blendv_pd( dy0, udy, near_u );
+
+	__m256d xsv_ext = _mm256_blendv_pd( ux,  lx,  lower );
+	__m256d ysv_ext = _mm256_blendv_pd( uy,  ly,  lower );
+	__m256d dx_ext  = _mm256_blendv_pd( udx, ldx, lower );
+	__m256d dy_ext  = _mm256_blendv_pd( udy, ldy, lower );
+
+	// the (1,1) triangle moves its base vertex
+	xsb = _mm256_blendv_pd( _mm256_add_pd( xsb, one ), xsb, lower );
+	ysb = _mm256_blendv_pd( _mm256_add_pd( ysb, one ), ysb, lower );
+	dx0 = _mm256_blendv_pd( _mm256_sub_pd( _mm256_sub_pd( dx0, one ), SQ2 ), dx0, lower );
+	dy0 = _mm256_blendv_pd( _mm256_sub_pd( _mm256_sub_pd( dy0, one ), SQ2 ), dy0, lower );
+
+	value = _mm256_add_pd( value, osn_batch_contrib4( ctx, xsb, ysb, dx0, dy0 ) );
+	value = _mm256_add_pd( value, osn_batch_contrib4( ctx, xsv_ext, ysv_ext, dx_ext, dy_ext ) );
+
+	return _mm256_div_pd( value, _mm256_set1_pd( OSN_NORM_CONSTANT_2D ) );
+}
+
+OSN_TGT static int osn_batch_run_avx2( const struct osn_batch_context *ctx, const float *x, const float *y, int n,
+									   double scale, double ox, double oy, float *out ){
+	const __m256d S  = _mm256_set1_pd( scale );
+	const __m256d OX = _mm256_set1_pd( ox );
+	const __m256d OY = _mm256_set1_pd( oy );
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d X = _mm256_add_pd( _mm256_mul_pd( _mm256_cvtps_pd( _mm_loadu_ps( x + i ) ), S ), OX );
+		__m256d Y = _mm256_add_pd( _mm256_mul_pd( _mm256_cvtps_pd( _mm_loadu_ps( y + i ) ), S ), OY );
+		_mm_storeu_ps( out + i, _mm256_cvtpd_ps( osn_batch_noise4( ctx, X, Y ) ) );
+	}
+	return i;
+}
+#undef OSN_TGT
+#endif
+
+// out[i] = noise( x[i] * scale + ox, y[i] * scale + oy ), same inputs main() used to pass one by one.
+static void open_simplex_noise2d_batch( const struct osn_batch_context *ctx, const float *x, const float *y, int n,
+										double scale, double ox, double oy, float *out ){
+	int i = 0;
+	#ifdef OSN_BATCH_HAVE_AVX2
+	if( ctx->use_avx2 ) i = osn_batch_run_avx2( ctx, x, y, n, scale, ox, oy, out );
+	#endif
+	for (; i < n; i++) {
+		out[i] = open_simplex_noise2d_ref( ctx, x[i] * scale + ox, y[i] * scale + oy );
+	}
+}
+
+// Max absolute difference between the batch path and the library's open_simplex_noise2d()
+// over n pseudo-random points in [-range, range]^2. Both contexts must share the seed.
+static double open_simplex_noise_batch_check( const struct osn_batch_context *bctx, const struct osn_context *ctx,
+											  int n, double range ){
+	float x [64], y [64], out [64];
+	uint32_t lcg = 2463534242u;
+	double worst = 0;
+	for (int done = 0; done < n; done += 64) {
+		for (int i = 0; i < 64; i++) {
+			lcg = lcg * 1664525u + 1013904223u;
+			x[i] = (float)( ((lcg >> 8) / 16777216.0 * 2 - 1) * range );
+			lcg = lcg * 1664525u + 1013904223u;
+			y[i] = (float)( ((lcg >> 8) / 16777216.0 * 2 - 1) * range );
+		}
+		open_simplex_noise2d_batch( bctx, x, y, 64, 1, 0, 0, out );
+		for (int i = 0; i < 64; i++) {
+			double d = fabs( out[i] - open_simplex_noise2d( ctx, x[i], y[i] ) );
+			if (d > worst) worst = d;
+		}
+	}
+	return worst;
+}
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef PNG_STREAM_H
+#define PNG_STREAM_H
+
+/*
+	Writes an 8 bit RGB PNG one scanline at a time, so images far larger than memory
+	can be encoded as they're rendered.
+
+	The zlib stream is a single fixed-Huffman deflate block. Its only back-references
+	are to the previous pixel (distance 3), which is all the flat color runs of a poster
+	need, and it never has to look further back than 3 bytes. IDAT chunks are cut every
+	PNG_STREAM_CHUNK bytes. Rows use filter 0.
+
+	png_stream_open(), then png_stream_row() height times, then png_stream_close(),
+	which returns 0 if anything failed to write.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#define PNG_STREAM_CHUNK (1 << 20)
+
+typedef struct {
+
+	FILE *f;
+	int width, height, rows;
+	int ok;
+
+	Uint8 *chunk; // IDAT payload being collected
+	int chunk_len;
+	Uint32 bits;  // deflate bits not yet in chunk, LSB first
+	int nbits;
+	Uint32 adler_a, adler_b;
+	Uint8 hist [3]; // last 3 bytes of the uncompressed stream
+	int hist_len;
+
+} png_stream;
+
+static Uint32 png_crc_table [256];
+
+static void png_crc_init( void ){
+	if( png_crc_table[1] != 0 ) return;
+	for (Uint32 n = 0; n < 256; ++n ){
+		Uint32 c = n;
+		for (int k = 0; k < 8; ++k ) c = (c & 1)? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		png_crc_table[n] = c;
+	}
+}
+
+static Uint32 png_crc( Uint32 crc, const Uint8 *data, size_t len ){
+	for (size_t i = 0; i < len; ++i ) crc = png_crc_table[ (crc ^ data[i]) & 0xFF ] ^ (crc >> 8);
+	return crc;
+}
+
+static void png_put32( Uint8 *p, Uint32 v ){
+	p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static void png_write_chunk( png_stream *P, const char *type, const Uint8 *data, Uint32 len ){
+	Uint8 head [8];
+	png_put32( head, len );
+	memcpy( head + 4, type, 4 );
+	Uint32 crc = png_crc( 0xFFFFFFFFu, head + 4, 4 );
+	crc = png_crc( crc, data, len ) ^ 0xFFFFFFFFu;
+	Uint8 tail [4];
+	png_put32( tail, crc );
+	P->ok &= ( fwrite( head, 1, 8, P->f ) == 8 );
+	if( len > 0 ) P->ok &= ( fwrite( data, 1, len, P->f ) == len );
+	P->ok &= ( fwrite( tail, 1, 4, P->f ) == 4 );
+}
+
+static void png_flush_chunk( png_stream *P ){
+	if( P->chunk_len == 0 ) return;
+	png_write_chunk( P, "IDAT", P->chunk, P->chunk_len );
+	P->chunk_len = 0;
+}
+
+static void png_byte( png_stream *P, Uint8 b ){
+	P->chunk[ P->chunk_len++ ] = b;
+	if( P->chunk_len == PNG_STREAM_CHUNK ) png_flush_chunk( P );
+}
+
+// n bits of v, LSB first
+static void png_bits( png_stream *P, Uint32 v, int n ){
+	P->bits |= v << P->nbits;
+	P->nbits += n;
+	while( P->nbits >= 8 ){
+		png_byte( P, P->bits & 0xFF );
+		P->bits >>= 8;
+		P->nbits -= 8;
+	}
+}
+
+// a Huffman code of n bits, which deflate stores MSB first
+static void png_code( png_stream *P, Uint32 code, int n ){
+	Uint32 r = 0;
+	for (int i = 0; i < n; ++i ) r |= ((code >> i) & 1) << (n - 1 - i);
+	png_bits( P, r, n );
+}
+
+// fixed literal/length code
+static void png_symbol( png_stream *P, int s ){
+	if( s < 144 )      png_code( P, 0x30 + s, 8 );
+	else if( s < 256 ) png_code( P, 0x190 + (s - 144), 9 );
+	else if( s < 280 ) png_code( P, s - 256, 7 );
+	else               png_code( P, 0xC0 + (s - 280), 8 );
+}
+
+// a back-reference of len (3..258) bytes, distance 3
+static void png_match( png_stream *P, int len ){
+	static const Uint16 base [29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+	static const Uint8 extra [29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+	int c = 28;
+	while( base[c] > len ) c--;
+	png_symbol( P, 257 + c );
+	if( extra[c] ) png_bits( P, len - base[c], extra[c] );
+	png_code( P, 2, 5 ); // distance code 2: distance 3
+}
+
+static void png_deflate( png_stream *P, const Uint8 *data, int len ){
+	for (int i = 0; i < len; ++i ){
+		P->adler_a = (P->adler_a + data[i]) % 65521;
+		P->adler_b = (P->adler_b + P->adler_a) % 65521;
+	}
+	// the byte 3 back from data[i], from hist while i < 3
+	#define PNG_BACK3( i ) ( (i) >= 3? data[(i)-3] : P->hist[ P->hist_len - 3 + (i) ] )
+	int i = 0;
+	while( i < len ){
+		int run = 0;
+		if( P->hist_len + i >= 3 ){
+			while( i + run < len && run < 258 && data[i+run] == PNG_BACK3( i+run ) ) run++;
+		}
+		if( run >= 3 ){
+			png_match( P, run );
+			i += run;
+		}
+		else{
+			png_symbol( P, data[i] );
+			i++;
+		}
+	}
+	#undef PNG_BACK3
+	for (int k = (len >= 3)? len - 3 : 0; k < len; ++k ){
+		if( P->hist_len == 3 ){
+			P->hist[0] = P->hist[1];
+			P->hist[1] = P->hist[2];
+			P->hist_len = 2;
+		}
+		P->hist[ P->hist_len++ ] = data[k];
+	}
+}
+
+static int png_stream_open( png_stream *P, const char *filename, int width, int height ){
+	png_crc_init();
+	memset( P, 0, sizeof(png_stream) );
+	P->f = fopen( filename, "wb" );
+	if( P->f == NULL ) return 0;
+	P->chunk = malloc( PNG_STREAM_CHUNK );
+	P->width = width;
+	P->height = height;
+	P->ok = 1;
+	P->adler_a = 1;
+
+	static const Uint8 signature [8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	P->ok &= ( fwrite( signature, 1, 8, P->f ) == 8 );
+	Uint8 ihdr [13];
+	png_put32( ihdr, width );
+	png_put32( ihdr + 4, height );
+	ihdr[8] = 8;  // bit depth
+	ihdr[9] = 2;  // RGB
+	ihdr[10] = 0; // deflate
+	ihdr[11] = 0; // adaptive filtering
+	ihdr[12] = 0; // no interlace
+	png_write_chunk( P, "IHDR", ihdr, 13 );
+
+	png_byte( P, 0x78 ); // zlib header: deflate, 32K window, no dictionary
+	png_byte( P, 0x01 );
+	png_bits( P, 1, 1 ); // BFINAL
+	png_bits( P, 1, 2 ); // fixed Huffman
+	return P->ok;
+}
+
+// One row of width RGB pixels.
+static void png_stream_row( png_stream *P, const Uint8 *rgb ){
+	const Uint8 filter = 0;
+	png_deflate( P, &filter, 1 );
+	png_deflate( P, rgb, 3 * P->width );
+	P->rows++;
+}
+
+static int png_stream_close( png_stream *P ){
+	if( P->f == NULL ) return 0;
+	png_symbol( P, 256 ); // end of block
+	if( P->nbits > 0 ) png_bits( P, 0, 8 - P->nbits );
+	Uint8 adler [4];
+	png_put32( adler, (P->adler_b << 16) | P->adler_a );
+	for (int i = 0; i < 4; ++i ) png_byte( P, adler[i] );
+	png_flush_chunk( P );
+	png_write_chunk( P, "IEND", NULL, 0 );
+	P->ok &= ( P->rows == P->height );
+	P->ok &= ( fclose( P->f ) == 0 );
+	free( P->chunk );
+	P->f = NULL;
+	return P->ok;
+}
+
+#endif
@@ -10,6 +10,25 @@
 #include "primitives.h"
 #include "libcyaml/cyaml.h"
 #include "open-simplex-noise.h"
+#include "open-simplex-noise-batch.h"
+#include "thread_pool.h"
+#include "png_stream.h"
+#include "frame_stream.h"
+#include "frame_stats.h"
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#include <malloc.h>
+#define make_dir( path ) _mkdir( path )
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define make_dir( path ) mkdir( path, 0777 )
+#endif
 
 SDL_Color lerp_through_array( Uint32 *palette, int palette_count, float amt ){
 	SDL_Color out = {0,0,0,0};
@@ -89,6 +108,110 @@ vec2d warr_to_v2d( int *A ){
 void sprint_wc( Wcoord A, char *buf ){
 	sprintf( buf, "%d,%d,%d,%d", A.w[0], A.w[1], A.w[2], A.w[3] );
 }
+bool wc_equal( Wcoord A, Wcoord B ){
+	return A.w[0] == B.w[0] && A.w[1] == B.w[1] && A.w[2] == B.w[2] && A.w[3] == B.w[3];
+}
+
+const Wcoord dir12 [12] = {
+	{{ 1, 0, 0, 0}}, {{ 0, 1, 0, 0}}, {{ 0, 0, 1, 0}}, {{ 0, 0, 0, 1}},
+	{{-1, 0, 1, 0}}, {{ 0,-1, 0, 1}}, {{-1, 0, 0, 0}}, {{ 0,-1, 0, 0}},
+	{{ 0, 0,-1, 0}}, {{ 0, 0, 0,-1}}, {{ 1, 0,-1, 0}}, {{ 0, 1, 0,-1}}
+};
+
+
+// Flat open-addressing hash set of lattice points, keyed directly by the 4 ints.
+// Each slot carries an int value (we store seed index + 1); 0 means "empty",
+// so wc_set_get() answers like ok_map_get() did on the old string map.
+typedef struct {
+	Wcoord *keys;
+	int *vals;
+	Uint32 mask;
+	int count;
+} wc_set;
+
+Uint32 wc_hash( Wcoord A ){
+	Uint32 h = (Uint32)A.w[0] * 0x9E3779B1u;
+	h ^= (Uint32)A.w[1] * 0x85EBCA77u;
+	h ^= (Uint32)A.w[2] * 0xC2B2AE3Du;
+	h ^= (Uint32)A.w[3] * 0x27D4EB2Fu;
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 13;
+	return h;
+}
+
+void wc_set_init( wc_set *S, int expected ){
+	Uint32 cap = 16;
+	while( cap < 2 * (Uint32)expected ) cap <<= 1;
+	S->keys = malloc( cap * sizeof(Wcoord) );
+	S->vals = calloc( cap, sizeof(int) );
+	S->mask = cap - 1;
+	S->count = 0;
+}
+void wc_set_deinit( wc_set *S ){
+	free( S->keys );
+	free( S->vals );
+	S->keys = NULL;
+	S->vals = NULL;
+	S->mask = 0;
+	S->count = 0;
+}
+
+void wc_set_put( wc_set *S, Wcoord A, int val );
+
+void wc_set_grow( wc_set *S ){
+	wc_set old = *S;
+	wc_set_init( S, (old.mask + 1) );
+	for (Uint32 i = 0; i <= old.mask; ++i ){
+		if( old.vals[i] ) wc_set_put( S, old.keys[i], old.vals[i] );
+	}
+	wc_set_deinit( &old );
+}
+
+void wc_set_put( wc_set *S, Wcoord A, int val ){
+	if( 2 * (Uint32)(S->count + 1) > S->mask + 1 ) wc_set_grow( S );
+	Uint32 i = wc_hash( A ) & S->mask;
+	while( S->vals[i] ){
+		if( wc_equal( S->keys[i], A ) ){
+			S->vals[i] = val;
+			return;
+		}
+		i = (i + 1) & S->mask;
+	}
+	S->keys[i] = A;
+	S->vals[i] = val;
+	S->count++;
+}
+
+// wc_set_put() for several threads filling a set that was sized up front: it never grows.
+// A slot is claimed by swapping its value from 0 to -1 and published once the key is in.
+// An existing key keeps its value. Returns 1 if A was new.
+int wc_set_put_shared( wc_set *S, Wcoord A, int val ){
+	Uint32 i = wc_hash( A ) & S->mask;
+	while( 1 ){
+		SDL_atomic_t *slot = (SDL_atomic_t*)( S->vals + i );
+		int v = SDL_AtomicGet( slot );
+		if( v == 0 ){
+			if( !SDL_AtomicCAS( slot, 0, -1 ) ) continue; // lost it, look again
+			S->keys[i] = A;
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet( slot, val );
+			return 1;
+		}
+		if( v < 0 ) continue; // key on its way
+		if( wc_equal( S->keys[i], A ) ) return 0;
+		i = (i + 1) & S->mask;
+	}
+}
+
+int wc_set_get( wc_set *S, Wcoord A ){
+	Uint32 i = wc_hash( A ) & S->mask;
+	while( S->vals[i] ){
+		if( wc_equal( S->keys[i], A ) ) return S->vals[i];
+		i = (i + 1) & S->mask;
+	}
+	return 0;
+}
 
 const cyaml_config_t cyamlconfig = {
 	.log_fn = cyaml_log,            /* Use the default logging function. */
@@ -115,6 +238,22 @@ struct config {
 	float halo_strength;
 
 	int frame_period;
+
+	int threads;
+
+	int noise_grid;
+	float noise_grid_cell;
+
+	int svg_decimals;
+	int svg_merge;
+	int svg_instances;
+	int svg_levels;
+
+	char *tiling_cache;
+
+	int aa_mode;
+
+	char *frame_trace;
 };
 
 const cyaml_schema_value_t color_schema = {
@@ -140,6 +279,33 @@ static const cyaml_schema_field_t the_schema[] = {
 	CYAML_FIELD_FLOAT( "halo_strength", CYAML_FLAG_DEFAULT, struct config, halo_strength ),
 
 	CYAML_FIELD_UINT( "frame period", CYAML_FLAG_DEFAULT, struct config, frame_period ),
+
+	// 0 or missing: one per core, 1: serial
+	CYAML_FIELD_UINT( "threads", CYAML_FLAG_DEFAULT | CYAML_FLAG_OPTIONAL, struct config, threads ),
+
+	// 1: sample quad_factor from a cached coarse noise lattice instead of per polygon.
+	// cell size in screen pixels; 0 or missing: the smallest polygon radius.
+	CYAML_FIELD_UINT(  "noise_grid", CYAML_FLAG_DEFAULT | CYAML_FLAG_OPTIONAL, struct config, noise_grid ),
+	CYAML_FIELD_FLOAT( "noise_grid_cell", CYAML_FLAG_DEFAULT | CYAML_FLAG_OPTIONAL, struct config, noise_grid_cell ),
+
+	// decimals kept in exported coordinates; 0 or missing: 2.
+	// svg_merge 1: one <path> per fill color instead of one per face.
+	CYAML_FIELD_UINT( "svg_decimals", CYAML_FLAG_DEFAULT | CYAML_FLAG_OPTIONAL, struct config, svg_decimals ),
+	CYAML_FIELD_UINT( "svg_merge", CYAML_FLAG_DEFAULT | CYAML_FLAG_OPTIONAL, struct config, svg_merge ),
+	// svg_instances 1: each prototype ring is written once in <defs> and placed with <use>,
+	// quad_factor rounded to svg_levels steps (0 or missing: 64) so rings can be shared.
+	CYAML_FIELD_UINT( "svg_instances", CYAML_FLAG_DEFAULT | CYAML_FLAG_OPTIONAL, struct config, svg_instances ),
+	CYAML_FIELD_UINT( "svg_levels", CYAML_FLAG_DEFAULT | CYAML_FLAG_OPTIONAL, struct config, svg_levels ),
+
+	// directory for generated polygon sets; missing: "cache", empty: don't cache.
+	CYAML_FIELD_STRING_PTR( "tiling_cache", CYAML_FLAG_POINTER_NULL_STR | CYAML_FLAG_OPTIONAL, struct config, tiling_cache, 0, INT32_MAX ),
+
+	// 0 or missing: draw at AA_Level x the window size and scale down.
+	// 1: draw at window size, with exact (analytic) edge coverage. AA_Level still sets the coordinate scale.
+	CYAML_FIELD_UINT( "AA_mode", CYAML_FLAG_DEFAULT | CYAML_FLAG_OPTIONAL, struct config, aa_mode ),
+
+	// CSV file getting the phase timings of every drawn frame; missing or empty: none.
+	CYAML_FIELD_STRING_PTR( "frame_trace", CYAML_FLAG_POINTER_NULL_STR | CYAML_FLAG_OPTIONAL, struct config, frame_trace, 0, INT32_MAX ),
 	CYAML_FIELD_END
 };
 
@@ -185,18 +351,69 @@ const cyaml_schema_value_t Tess_seq_schema_value = {
 	CYAML_VALUE_SEQUENCE( CYAML_FLAG_POINTER_NULL, Tess, &Tess_value, 0, INT32_MAX ) 
 };
 
+typedef struct {
+	wc_set *S;
+	Tess *TT;
+	int WN, HN;
+	SDL_atomic_t count;
+} lattice_job;
+
+static void lattice_rows( void *data, int a, int b ){
+	lattice_job *LJ = data;
+	Tess *TT = LJ->TT;
+	int added = 0;
+	for ( int x = a - LJ->WN; x < b - LJ->WN; x++ ) {
+		for ( int y = -LJ->HN; y < LJ->HN; y++ ) {
+			Wcoord trans = wc_sum( wc_scaled( TT->T1, x ), wc_scaled( TT->T2, y ) );
+			for (int s = 0; s < TT->seed_count; s++) {
+				added += wc_set_put_shared( LJ->S, wc_plus_warr( TT->seed[s], trans ), (s+1) );
+			}
+		}
+	}
+	SDL_AtomicAdd( &LJ->count, added );
+}
+
+// Expands the seed points over the [-WN, WN) x [-HN, HN) translation cells into S,
+// a translation row x per job on TP (NULL: on this thread). S holds at most one point
+// per cell and seed, so it's sized for that and filled in place with wc_set_put_shared().
+// Values are seed index + 1, as the face discovery only needs to know "present".
+void build_lattice( wc_set *S, Tess *TT, int WN, int HN, thread_pool *TP ){
+	wc_set_init( S, 4 * WN * HN * TT->seed_count );
+	lattice_job LJ = { S, TT, WN, HN };
+	SDL_AtomicSet( &LJ.count, 0 );
+	if( TP != NULL ) pool_run_ranges( TP, lattice_rows, &LJ, 2*WN, 1 );
+	else lattice_rows( &LJ, 0, 2*WN );
+	S->count = SDL_AtomicGet( &LJ.count );
+}
+
 
 
+// Prototype of a regular polygon at one scale and orientation: vertices relative to the
+// center, the outward unit normal of each edge V[v] -> V[v+1], circumradius and apothem.
 typedef struct{
 	vec2d *V;
+	vec2d *N;
+	double radius, apothem;
 } geo;
 
+void geo_init( geo *G, int sides, double angle, double radius ){
+	G->V = malloc( sides * sizeof(vec2d) );
+	G->N = malloc( sides * sizeof(vec2d) );
+	G->radius = radius;
+	G->apothem = radius * cos( M_PI / sides );
+	for (int v = 0; v < sides; ++v ){
+		double theta = angle + v * TWO_PI / sides;
+		G->V[v] = v2d( radius*cos(theta), radius*sin(theta) );
+		G->N[v] = v2d( cos(theta + M_PI / sides), sin(theta + M_PI / sides) );
+	}
+}
+
 typedef struct regpol{
 	
 	int sides;
 	int angle;
 	vec2d center;
-	float quad_factor;
+	int id; // index into the poly_store, where quad_factor lives
 	geo *G;
 	SDL_Color *color;
 
@@ -204,6 +421,8 @@ typedef struct regpol{
 
 typedef struct ok_vec_of(regular_poly) regpolvec;
 
+const double radii [] = { 0, 0, 0, 0.5773502691, 0.707106781186, 0, 1, 0, 0, 0, 0, 0, 1.93185165257 };
+
 const double two_pi_over[] = {0, 6.283185307180, 3.141592653590, 2.094395102393, 1.570796326795, 1.256637061436, 1.047197551197, 0.897597901026, 0.785398163397, 0.698131700798, 0.628318530718, 0.571198664289, 0.523598775598, 0.483321946706, 0.448798950513, 0.418879020479, 0.392699081699};
 
 //modf but good
@@ -274,39 +493,219 @@ double angle_from_id( int sides, int angle_id ){
 	return 0;
 }
 
-typedef struct zvs ok_vec_of(regular_poly*) zonevec;
+// Uniform grid over bounds for picking and culling, sized from the polygon count and
+// the smallest polygon radius instead of a fixed 16x9. Cells are stored CSR style: the
+// polygons of cell c are items[ start[c] .. start[c+1] ), and each polygon is listed in
+// every cell its bounding circle's box overlaps, so a point query only scans one cell.
+typedef struct {
+	SDL_Rect area;
+	int cols, rows;
+	float icw, ich; // inverse cell size
+	int *start;
+	regular_poly **items;
+} zone_grid;
+
+// aims at a couple of polygons per cell, without cells smaller than the smallest polygon
+void zone_grid_dims( SDL_Rect *area, int N, float smallest_radius, int *cols, int *rows ){
+	double cell = sqrt( (double)area->w * area->h * 2.0 / max( N, 1 ) );
+	if( cell < smallest_radius ) cell = smallest_radius;
+	*cols = max( 1, (int)ceil( area->w / cell ) );
+	*rows = max( 1, (int)ceil( area->h / cell ) );
+}
+
+static inline int zone_col( zone_grid *Z, double x ){
+	int I = (int)(( x - Z->area.x) * Z->icw);
+	return (I < 0)? 0 : (I >= Z->cols)? Z->cols-1 : I;
+}
+static inline int zone_row( zone_grid *Z, double y ){
+	int J = (int)(( y - Z->area.y) * Z->ich);
+	return (J < 0)? 0 : (J >= Z->rows)? Z->rows-1 : J;
+}
+
+void zone_grid_build( zone_grid *Z, regpolvec *regpols, SDL_Rect *area, int cols, int rows, double scale ){
+	Z->area = *area;
+	Z->cols = cols;
+	Z->rows = rows;
+	//these are inverses. we only ever need to divide by the w/h.
+	Z->icw = cols / (float)area->w;
+	Z->ich = rows / (float)area->h;
+	Z->start = calloc( cols * rows + 1, sizeof(int) );
+
+	// count, prefix sum, fill
+	ok_vec_foreach_ptr( regpols, regular_poly *P ){
+		double radius = scale * radii[ P->sides ];
+		int I0 = zone_col( Z, P->center.x - radius ), I1 = zone_col( Z, P->center.x + radius );
+		int J0 = zone_row( Z, P->center.y - radius ), J1 = zone_row( Z, P->center.y + radius );
+		for (int J = J0; J <= J1; ++J ){
+			for (int I = I0; I <= I1; ++I ) Z->start[ I + J*cols + 1 ]++;
+		}
+	}
+	for (int c = 0; c < cols * rows; ++c ) Z->start[c+1] += Z->start[c];
+	Z->items = malloc( max( Z->start[ cols * rows ], 1 ) * sizeof(regular_poly*) );
+	int *fill = malloc( cols * rows * sizeof(int) );
+	memcpy( fill, Z->start, cols * rows * sizeof(int) );
+	ok_vec_foreach_ptr( regpols, regular_poly *P ){
+		double radius = scale * radii[ P->sides ];
+		int I0 = zone_col( Z, P->center.x - radius ), I1 = zone_col( Z, P->center.x + radius );
+		int J0 = zone_row( Z, P->center.y - radius ), J1 = zone_row( Z, P->center.y + radius );
+		for (int J = J0; J <= J1; ++J ){
+			for (int I = I0; I <= I1; ++I ) Z->items[ fill[ I + J*cols ]++ ] = P;
+		}
+	}
+	free( fill );
+}
+
+void zone_grid_free( zone_grid *Z ){
+	free( Z->start );
+	free( Z->items );
+	Z->start = NULL;
+	Z->items = NULL;
+}
+
+// Half-plane test against the prototype's edge normals. The circumradius and apothem
+// settle most points before the per-edge loop.
+bool poly_contains( regular_poly *rp, vec2d p ){
+	double dx = p.x - rp->center.x;
+	double dy = p.y - rp->center.y;
+	double d2 = dx*dx + dy*dy;
+	geo *G = rp->G;
+	if( d2 > G->radius * G->radius ) return 0;
+	if( d2 <= G->apothem * G->apothem ) return 1;
+	for (int v = 0; v < rp->sides; ++v ){
+		if( dx * G->N[v].x + dy * G->N[v].y > G->apothem ) return 0;
+	}
+	return 1;
+}
+
+// Whether the segment a-b touches the polygon: Cyrus-Beck clipping against the same half-planes.
+bool poly_crosses( regular_poly *rp, vec2d a, vec2d b ){
+	double ax = a.x - rp->center.x, ay = a.y - rp->center.y;
+	double dx = b.x - a.x, dy = b.y - a.y;
+	geo *G = rp->G;
+	// distance from the center to the segment, against radius and apothem
+	double len2 = dx*dx + dy*dy;
+	double t = (len2 > 0)? constrainF( -(ax*dx + ay*dy) / len2, 0, 1 ) : 0;
+	double cx = ax + t*dx, cy = ay + t*dy;
+	double d2 = cx*cx + cy*cy;
+	if( d2 > G->radius * G->radius ) return 0;
+	if( d2 <= G->apothem * G->apothem ) return 1;
+	double t0 = 0, t1 = 1;
+	for (int v = 0; v < rp->sides; ++v ){
+		double num = G->apothem - (ax * G->N[v].x + ay * G->N[v].y);
+		double den = dx * G->N[v].x + dy * G->N[v].y;
+		if( den == 0 ){
+			if( num < 0 ) return 0;
+		}
+		else if( den > 0 ) t1 = fmin( t1, num / den );
+		else               t0 = fmax( t0, num / den );
+		if( t0 > t1 ) return 0;
+	}
+	return 1;
+}
+
+// polygon under p (AA pixels), or NULL
+regular_poly *zone_grid_pick( zone_grid *Z, vec2d p ){
+	if( Z->start == NULL ) return NULL;
+	if( !coordinates_in_Rect( p.x, p.y, &(Z->area) ) ) return NULL;
+	int c = zone_col( Z, p.x ) + zone_row( Z, p.y ) * Z->cols;
+	for (int k = Z->start[c]; k < Z->start[c+1]; ++k ){
+		if( poly_contains( Z->items[k], p ) ) return Z->items[k];
+	}
+	return NULL;
+}
 
-void paint_poly( SDL_Color *paint, vec2d mouse, zonevec *zones, int zone_cols, int AAx, SDL_Rect *bounds, float zone_iw, float zone_ih ){
+// paint is a face color array, like regular_poly.color: a palettes.solid entry.
+// returns whether a polygon changed color
+bool paint_poly( SDL_Color *paint, vec2d mouse, zone_grid *zones, int AAx ){
 	
 	v2d_mult( &mouse, AAx );
-	if( !coordinates_in_Rect( mouse.x, mouse.y, bounds ) ) return;
-
-	int MI = (int)(( mouse.x - bounds->x) * zone_iw);
-	int MJ = (int)(( mouse.y - bounds->y) * zone_ih);
-	int MZ = MI + (MJ*zone_cols);
-	//int zn = ok_vec_count( zones + MZ );
-	//printf("___%d, %d. (%d)\n", MI, MJ, zn );
-	vec2d mouseray = v2d( mouse.x + 1000, mouse.y+10 );
-	v2d_mult( &mouseray, AAx );
-	
-	vec2d VT [12];
-	ok_vec_foreach(zones + MZ, regular_poly *rp) {
-	//for (int i = 0; i < zn; ++i ){
-	//	regular_poly *rp = ok_vec_get(zones + MZ, i);
-		for (int v = 0; v < rp->sides; ++v ){
-			VT[v] = v2d( rp->center.x + rp->G->V[v].x, rp->center.y + rp->G->V[v].y );
+	regular_poly *rp = zone_grid_pick( zones, mouse );
+	if( rp == NULL || rp->color == paint ) return 0;
+	rp->color = paint;
+	return 1;
+}
+
+// Paints every polygon the mouse segment a-b (screen pixels) passes over, walking the
+// zones it crosses in one DDA traversal. Returns how many polygons changed color.
+int paint_stroke( SDL_Color *paint, vec2d a, vec2d b, zone_grid *zones, int AAx ){
+
+	if( zones->start == NULL ) return 0;
+
+	v2d_mult( &a, AAx );
+	v2d_mult( &b, AAx );
+
+	// clip the segment to the grid area
+	double dx = b.x - a.x, dy = b.y - a.y;
+	double t0 = 0, t1 = 1;
+	double p [4] = { -dx, dx, -dy, dy };
+	double q [4] = { a.x - zones->area.x, zones->area.x + zones->area.w - a.x, 
+	                 a.y - zones->area.y, zones->area.y + zones->area.h - a.y };
+	for (int k = 0; k < 4; ++k ){
+		if( p[k] == 0 ){
+			if( q[k] < 0 ) return 0;
 		}
-		int ic = 0;
-		for (int v = 0; v < rp->sides-1; ++v ){
-			ic += intersection( VT[v], VT[v+1], mouse, mouseray );
+		else if( p[k] < 0 ) t0 = fmax( t0, q[k] / p[k] );
+		else                t1 = fmin( t1, q[k] / p[k] );
+	}
+	if( t0 > t1 ) return 0;
+
+	// in cell units
+	double x0 = (a.x + t0*dx - zones->area.x) * zones->icw, y0 = (a.y + t0*dy - zones->area.y) * zones->ich;
+	double x1 = (a.x + t1*dx - zones->area.x) * zones->icw, y1 = (a.y + t1*dy - zones->area.y) * zones->ich;
+	int I = max( 0, min( (int)x0, zones->cols-1 ) ), J = max( 0, min( (int)y0, zones->rows-1 ) );
+	int IE = max( 0, min( (int)x1, zones->cols-1 ) ), JE = max( 0, min( (int)y1, zones->rows-1 ) );
+	int si = (x1 > x0)? 1 : -1, sj = (y1 > y0)? 1 : -1;
+	double tdx = (x1 != x0)? 1.0 / fabs(x1 - x0) : INFINITY;
+	double tdy = (y1 != y0)? 1.0 / fabs(y1 - y0) : INFINITY;
+	double tx = (x1 != x0)? ((si > 0)? (I + 1 - x0) : (x0 - I)) * tdx : INFINITY;
+	double ty = (y1 != y0)? ((sj > 0)? (J + 1 - y0) : (y0 - J)) * tdy : INFINITY;
+
+	int painted = 0;
+	int steps = abs( IE - I ) + abs( JE - J );
+	for (int s = 0; s <= steps; ++s ){
+		int c = I + J * zones->cols;
+		for (int k = zones->start[c]; k < zones->start[c+1]; ++k ){
+			regular_poly *rp = zones->items[k];
+			if( rp->color != paint && poly_crosses( rp, a, b ) ){
+				rp->color = paint;
+				painted++;
+			}
 		}
-		ic += intersection( VT[rp->sides-1], VT[0], mouse, mouseray );
+		if( tx < ty ){ I += si; tx += tdx; }
+		else         { J += sj; ty += tdy; }
+	}
+	return painted;
+}
 
-		if( ic % 2 == 1 ){
-			rp->color = paint;
-			return;
+
+// Flags the polygons whose bounding circle touches `view`, visiting only the zones that
+// overlap it. Returns the visible count; visible[] is indexed like regpols.
+int cull_to_viewport( regpolvec *regpols, bool *visible, zone_grid *zones, SDL_Rect *view, double scale ){
+
+	memset( visible, 0, ok_vec_count( regpols ) * sizeof(bool) );
+	// no zones were built (no tesselation loaded): nothing to see
+	if( zones->start == NULL ) return 0;
+	int I0 = zone_col( zones, view->x ), I1 = zone_col( zones, view->x + view->w );
+	int J0 = zone_row( zones, view->y ), J1 = zone_row( zones, view->y + view->h );
+	int count = 0;
+	for (int J = J0; J <= J1; ++J ){
+		for (int I = I0; I <= I1; ++I ){
+			int c = I + J * zones->cols;
+			for (int k = zones->start[c]; k < zones->start[c+1]; ++k ){
+				regular_poly *rp = zones->items[k];
+				int r = rp - regpols->values;
+				if( visible[r] ) continue;
+				double radius = scale * radii[ rp->sides ];
+				double dx = rp->center.x - constrainF( rp->center.x, view->x, view->x + view->w );
+				double dy = rp->center.y - constrainF( rp->center.y, view->y, view->y + view->h );
+				if( dx*dx + dy*dy <= radius*radius ){
+					visible[r] = 1;
+					count++;
+				}
+			}
 		}
 	}
+	return count;
 }
 
 
@@ -364,9 +763,10 @@ void gp_quadpoly_mono( SDL_Renderer *R, int sides, vec2d center, vec2d *V, float
 	}
 }
 
-void gp_quadpoly( SDL_Renderer *R, regular_poly *P, int offset ){
+// Returns the number of SDL_RenderGeometry() calls, 0 if the polygon is skipped.
+int gp_quadpoly( SDL_Renderer *R, regular_poly *P, float quad_factor, int offset ){
 
-	if( P->quad_factor <= 0 || P->quad_factor >= 1 ) return;
+	if( quad_factor <= 0 || quad_factor >= 1 ) return 0;
 
 	static const int indices [6] = { 0, 2, 3, 0, 3, 1 };
 
@@ -381,21 +781,487 @@ void gp_quadpoly( SDL_Renderer *R, regular_poly *P, int offset ){
 											P->center.y +                  P->G->V[s ].y }, P->color[C], {0,0} };//(C+1)%sides
 		verts[1] = (SDL_Vertex){ { P->center.x +                  P->G->V[ns].x, 
 											P->center.y +                  P->G->V[ns].y }, P->color[C], {0,0} };//(C+2)%sides
-		verts[2] = (SDL_Vertex){ { P->center.x + P->quad_factor * P->G->V[s ].x,  
-											P->center.y + P->quad_factor * P->G->V[s ].y }, P->color[C], {0,0} };//(C+3)%sides
-		verts[3] = (SDL_Vertex){ { P->center.x + P->quad_factor * P->G->V[ns].x, 
-											P->center.y + P->quad_factor * P->G->V[ns].y }, P->color[C], {0,0} };//(C+4)%sides
+		verts[2] = (SDL_Vertex){ { P->center.x + quad_factor * P->G->V[s ].x,  
+											P->center.y + quad_factor * P->G->V[s ].y }, P->color[C], {0,0} };//(C+3)%sides
+		verts[3] = (SDL_Vertex){ { P->center.x + quad_factor * P->G->V[ns].x, 
+											P->center.y + quad_factor * P->G->V[ns].y }, P->color[C], {0,0} };//(C+4)%sides
 
 		if( SDL_RenderGeometry( R, NULL, verts, 4, indices, 6 ) < 0 ){
 			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_RenderGeometry error: %s", SDL_GetError());
 		}
 	}
+	return P->sides;
+}
+
+
+// Structure-of-arrays copy of regpols for the per-frame loops. Polygons are sorted by
+// prototype, so each run of equal `proto` shares sides and vertex table, and the
+// kernels below can sweep several polygons per SIMD register without touching
+// regular_poly, geo or SDL_Color pointers. Arrays are padded to POLY_STORE_PAD.
+// Polygons that can reach the render target come first: per-frame work only
+// covers [0, visible), the rest is only needed for exports.
+#define POLY_STORE_PAD 8
+#define MAX_PROTOS 16
+
+// The float arrays are cache line aligned: SDL_SIMDAlloc() only promises the SIMD width,
+// 16 or 32 bytes on most CPUs, which would let pool_run() ranges share a line of qf.
+#define CACHE_LINE 64
+
+void *cache_line_alloc( size_t size ){
+#ifdef _WIN32
+	return _aligned_malloc( size, CACHE_LINE );
+#else
+	void *p = NULL;
+	return ( posix_memalign( &p, CACHE_LINE, size ) == 0 )? p : NULL;
+#endif
+}
+
+void cache_line_free( void *p ){
+#ifdef _WIN32
+	_aligned_free( p );
+#else
+	free( p );
+#endif
+}
+
+typedef struct {
+	int count;
+	int faces;
+	int visible;
+	int visible_faces;
+	float *cx;
+	float *cy;
+	float *qf;
+	Uint8 *sides;
+	Sint8 *angle;
+	Uint8 *proto;
+	regular_poly **src;
+
+	int protos;
+	float proto_x [MAX_PROTOS][12];
+	float proto_y [MAX_PROTOS][12];
+	int proto_sides [MAX_PROTOS];
+
+	int groups;
+	int group_start [2*MAX_PROTOS+1];
+	int group_face0 [2*MAX_PROTOS];
+	int group_proto [2*MAX_PROTOS];
+} poly_store;
+
+void build_poly_store( poly_store *PS, regpolvec *regpols, bool *visible, geo *protos, int proto_count ){
+
+	int N = ok_vec_count( regpols );
+	int padded = ((N + POLY_STORE_PAD - 1) / POLY_STORE_PAD) * POLY_STORE_PAD + POLY_STORE_PAD;
+	PS->count = N;
+	PS->cx = cache_line_alloc( padded * sizeof(float) );
+	PS->cy = cache_line_alloc( padded * sizeof(float) );
+	PS->qf = cache_line_alloc( padded * sizeof(float) );
+	PS->sides = malloc( padded );
+	PS->angle = malloc( padded );
+	PS->proto = malloc( padded );
+	PS->src = malloc( padded * sizeof(regular_poly*) );
+
+	PS->protos = proto_count;
+	for (int p = 0; p < proto_count; ++p ){
+		PS->proto_sides[p] = 0;
+	}
+
+	// counting sort by (culled, prototype): visible polygons first
+	int K = 2 * proto_count;
+	int start [2*MAX_PROTOS+1] = {0};
+	int r = 0;
+	ok_vec_foreach_ptr( regpols, regular_poly *P ){
+		int p = P->G - protos;
+		PS->proto_sides[p] = P->sides;
+		start[ p + (visible[r++]? 0 : proto_count) + 1 ]++;
+	}
+	for (int k = 0; k < K; ++k ) start[k+1] += start[k];
+	PS->visible = start[ proto_count ];
+
+	for (int p = 0; p < proto_count; ++p ){
+		for (int v = 0; v < PS->proto_sides[p]; ++v ){
+			PS->proto_x[p][v] = protos[p].V[v].x;
+			PS->proto_y[p][v] = protos[p].V[v].y;
+		}
+	}
+	PS->groups = 0;
+	PS->faces = 0;
+	for (int k = 0; k < K; ++k ){
+		if( k == proto_count ) PS->visible_faces = PS->faces;
+		int p = k % proto_count;
+		if( start[k+1] > start[k] ){
+			PS->group_start[ PS->groups ] = start[k];
+			PS->group_face0[ PS->groups ] = PS->faces;
+			PS->group_proto[ PS->groups ] = p;
+			PS->groups++;
+			PS->faces += (start[k+1] - start[k]) * PS->proto_sides[p];
+		}
+	}
+	if( K == 0 ) PS->visible_faces = 0;
+	PS->group_start[ PS->groups ] = N;
+
+	r = 0;
+	ok_vec_foreach_ptr( regpols, regular_poly *P ){
+		int p = P->G - protos;
+		int i = start[ p + (visible[r++]? 0 : proto_count) ]++;
+		PS->cx[i] = P->center.x;
+		PS->cy[i] = P->center.y;
+		PS->qf[i] = 1;
+		PS->sides[i] = P->sides;
+		PS->angle[i] = P->angle;
+		PS->proto[i] = p;
+		PS->src[i] = P;
+		P->id = i;
+	}
+	for (int i = N; i < padded; ++i ){
+		PS->cx[i] = 0;
+		PS->cy[i] = 0;
+		PS->qf[i] = 1;
+	}
+}
+
+void poly_store_free( poly_store *PS ){
+	cache_line_free( PS->cx );
+	cache_line_free( PS->cy );
+	cache_line_free( PS->qf );
+	free( PS->sides );
+	free( PS->angle );
+	free( PS->proto );
+	free( PS->src );
+	PS->count = 0;
+}
+
+
+// All visible quad faces of the store in one persistent vertex buffer, 4 vertices per face:
+// [0],[1] outer ring, [2],[3] inner ring (moves with quad_factor). Topology never
+// changes after generation, so the indices are built once. They are relative to
+// the start of a chunk, so every chunk reuses the same index prefix.
+#define QUAD_BATCH_CHUNK 65536
+
+typedef struct {
+	SDL_Vertex *verts;
+	int *indices;
+	int faces;
+	bool use_avx2; // resolved by build_quad_batch(), before any worker reads it
+} quad_batch;
+
+void quad_batch_colors( quad_batch *QB, poly_store *PS ){
+	SDL_Vertex *v = QB->verts;
+	for (int i = 0; i < PS->visible; ++i ){
+		regular_poly *P = PS->src[i];
+		for(int s = 0; s < P->sides; s++){
+			SDL_Color c = P->color[ (s + P->angle) % P->sides ];
+			v[0].color = c;
+			v[1].color = c;
+			v[2].color = c;
+			v[3].color = c;
+			v += 4;
+		}
+	}
+}
+
+void build_quad_batch( quad_batch *QB, poly_store *PS ){
+	QB->faces = PS->visible_faces;
+	QB->use_avx2 = SDL_HasAVX2();
+	QB->verts = calloc( 4 * QB->faces, sizeof(SDL_Vertex) );
+	int chunk = min( QB->faces, QUAD_BATCH_CHUNK );
+	QB->indices = malloc( 6 * chunk * sizeof(int) );
+	for (int f = 0; f < chunk; ++f ){
+		int *I = QB->indices + 6*f;
+		I[0] = 4*f;  I[1] = 4*f+2;  I[2] = 4*f+3;
+		I[3] = 4*f;  I[4] = 4*f+3;  I[5] = 4*f+1;
+	}
+	quad_batch_colors( QB, PS );
+}
+
+// Ring vertex s of an n-gon is the start of face s and the end of face s-1.
+static inline void store_ring_vertex( SDL_Vertex *pv, int n, int s, float ox, float oy, float ix, float iy ){
+	int ps = (s == 0)? n-1 : s-1;
+	pv[4*s ].position = (SDL_FPoint){ ox, oy };
+	pv[4*s +2].position = (SDL_FPoint){ ix, iy };
+	pv[4*ps+1].position = (SDL_FPoint){ ox, oy };
+	pv[4*ps+3].position = (SDL_FPoint){ ix, iy };
+}
+
+// Polygons gp_quadpoly() would skip get quad_factor 1, collapsing the inner ring onto the outer one.
+void quad_ring_kernel_scalar( SDL_Vertex *verts, poly_store *PS, int g, int a, int b ){
+	int p = PS->group_proto[g];
+	int n = PS->proto_sides[p];
+	float *PX = PS->proto_x[p];
+	float *PY = PS->proto_y[p];
+	int first = PS->group_start[g];
+	for (int i = a; i < b; ++i ){
+		float q = PS->qf[i];
+		if( q <= 0 || q >= 1 ) q = 1;
+		SDL_Vertex *pv = verts + 4 * (PS->group_face0[g] + (i - first) * n);
+		for (int s = 0; s < n; ++s ){
+			store_ring_vertex( pv, n, s, PS->cx[i] + PX[s], PS->cy[i] + PY[s],
+									     PS->cx[i] + q * PX[s], PS->cy[i] + q * PY[s] );
+		}
+	}
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAVE_SSE2_KERNEL 1
+
+// 4 polygons per iteration, returns where it stopped so the caller can finish the tail.
+int quad_ring_kernel_sse2( SDL_Vertex *verts, poly_store *PS, int g, int a, int b ){
+	int p = PS->group_proto[g];
+	int n = PS->proto_sides[p];
+	int first = PS->group_start[g];
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1 );
+	int i = a;
+	for (; i + 4 <= b; i += 4 ){
+		__m128 cx = _mm_loadu_ps( PS->cx + i );
+		__m128 cy = _mm_loadu_ps( PS->cy + i );
+		__m128 q  = _mm_loadu_ps( PS->qf + i );
+		__m128 skip = _mm_or_ps( _mm_cmple_ps( q, zero ), _mm_cmpge_ps( q, one ) );
+		q = _mm_or_ps( _mm_and_ps( skip, one ), _mm_andnot_ps( skip, q ) );
+		float ox [4], oy [4], ix [4], iy [4];
+		for (int s = 0; s < n; ++s ){
+			__m128 px = _mm_set1_ps( PS->proto_x[p][s] );
+			__m128 py = _mm_set1_ps( PS->proto_y[p][s] );
+			_mm_storeu_ps( ox, _mm_add_ps( cx, px ) );
+			_mm_storeu_ps( oy, _mm_add_ps( cy, py ) );
+			_mm_storeu_ps( ix, _mm_add_ps( cx, _mm_mul_ps( q, px ) ) );
+			_mm_storeu_ps( iy, _mm_add_ps( cy, _mm_mul_ps( q, py ) ) );
+			for (int l = 0; l < 4; ++l ){
+				SDL_Vertex *pv = verts + 4 * (PS->group_face0[g] + (i + l - first) * n);
+				store_ring_vertex( pv, n, s, ox[l], oy[l], ix[l], iy[l] );
+			}
+		}
+	}
+	return i;
+}
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNEL 1
+
+__attribute__((target("avx2")))
+int quad_ring_kernel_avx2( SDL_Vertex *verts, poly_store *PS, int g, int a, int b ){
+	int p = PS->group_proto[g];
+	int n = PS->proto_sides[p];
+	int first = PS->group_start[g];
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps( 1 );
+	int i = a;
+	for (; i + 8 <= b; i += 8 ){
+		__m256 cx = _mm256_loadu_ps( PS->cx + i );
+		__m256 cy = _mm256_loadu_ps( PS->cy + i );
+		__m256 q  = _mm256_loadu_ps( PS->qf + i );
+		__m256 skip = _mm256_or_ps( _mm256_cmp_ps( q, zero, _CMP_LE_OQ ), _mm256_cmp_ps( q, one, _CMP_GE_OQ ) );
+		q = _mm256_blendv_ps( q, one, skip );
+		float ox [8], oy [8], ix [8], iy [8];
+		for (int s = 0; s < n; ++s ){
+			__m256 px = _mm256_set1_ps( PS->proto_x[p][s] );
+			__m256 py = _mm256_set1_ps( PS->proto_y[p][s] );
+			_mm256_storeu_ps( ox, _mm256_add_ps( cx, px ) );
+			_mm256_storeu_ps( oy, _mm256_add_ps( cy, py ) );
+			_mm256_storeu_ps( ix, _mm256_add_ps( cx, _mm256_mul_ps( q, px ) ) );
+			_mm256_storeu_ps( iy, _mm256_add_ps( cy, _mm256_mul_ps( q, py ) ) );
+			for (int l = 0; l < 8; ++l ){
+				SDL_Vertex *pv = verts + 4 * (PS->group_face0[g] + (i + l - first) * n);
+				store_ring_vertex( pv, n, s, ox[l], oy[l], ix[l], iy[l] );
+			}
+		}
+	}
+	return i;
+}
+#endif
+
+// Rewrites outer and inner rings of polygons [a, b) of the store in one streaming sweep,
+// group by group, with the widest kernel the CPU has and the scalar one for the tails.
+void quad_batch_update_range( quad_batch *QB, poly_store *PS, int a, int b ){
+	for (int g = 0; g < PS->groups; ++g ){
+		int ga = max( a, PS->group_start[g] );
+		int gb = min( b, PS->group_start[g+1] );
+		if( ga >= gb ) continue;
+		#ifdef HAVE_AVX2_KERNEL
+		if( QB->use_avx2 ) ga = quad_ring_kernel_avx2( QB->verts, PS, g, ga, gb );
+		#endif
+		#ifdef HAVE_SSE2_KERNEL
+		ga = quad_ring_kernel_sse2( QB->verts, PS, g, ga, gb );
+		#endif
+		quad_ring_kernel_scalar( QB->verts, PS, g, ga, gb );
+	}
+}
+
+void quad_batch_update( quad_batch *QB, poly_store *PS ){
+	quad_batch_update_range( QB, PS, 0, PS->visible );
+}
+
+typedef struct {
+	quad_batch *QB;
+	poly_store *PS;
+} quad_batch_job;
+
+void quad_batch_job_range( void *data, int a, int b ){
+	quad_batch_job *J = data;
+	quad_batch_update_range( J->QB, J->PS, a, b );
+}
+
+// Returns the number of SDL_RenderGeometry() calls.
+int quad_batch_render( SDL_Renderer *R, quad_batch *QB ){
+	int calls = 0;
+	for (int f = 0; f < QB->faces; f += QUAD_BATCH_CHUNK ){
+		int n = min( QB->faces - f, QUAD_BATCH_CHUNK );
+		if( SDL_RenderGeometry( R, NULL, QB->verts + 4*f, 4*n, QB->indices, 6*n ) < 0 ){
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_RenderGeometry error: %s", SDL_GetError());
+		}
+		calls++;
+	}
+	return calls;
+}
+
+void quad_batch_free( quad_batch *QB ){
+	free( QB->verts );
+	free( QB->indices );
+	QB->verts = NULL;
+	QB->indices = NULL;
+	QB->faces = 0;
+}
+
+
+// Coarse lattice of raw noise values covering bounds, sampled bilinearly. Nodes sit at
+// fixed positions in noise space (i * h, j * h), so panning (nx, ny) just slides the
+// window: the values live in a ring buffer and only the rows and columns that scroll
+// into view get evaluated. Changing nscale changes h, which needs a full refill.
+typedef struct {
+	float cell;   // node spacing in AA pixels
+	int cols, rows;
+	float *val;   // ring buffer, node (i, j) at [ ring(i, cols) + ring(j, rows) * cols ]
+	double h;     // node spacing in noise space the values were made for
+	int i0, j0;   // absolute index of the window's first column / row
+	bool valid;
+	int computed; // nodes evaluated by the last update
+} noise_grid;
+
+static inline int ring( int i, int n ){
+	int r = i % n;
+	return (r < 0)? r + n : r;
+}
+
+void noise_grid_init( noise_grid *NG, SDL_Rect *bounds, float cell ){
+	NG->cell = cell;
+	NG->cols = ceil( bounds->w / cell ) + 3;
+	NG->rows = ceil( bounds->h / cell ) + 3;
+	NG->val = malloc( NG->cols * NG->rows * sizeof(float) );
+	NG->valid = 0;
+	NG->computed = 0;
+}
+
+static inline void noise_grid_fill( noise_grid *NG, struct osn_context *ctx, int i, int j ){
+	NG->val[ ring( i, NG->cols ) + ring( j, NG->rows ) * NG->cols ] = open_simplex_noise2d( ctx, i * NG->h, j * NG->h );
+	NG->computed++;
+}
+
+void noise_grid_update( noise_grid *NG, struct osn_context *ctx, SDL_Rect *bounds, double nscale, double nx, double ny ){
+	double h = NG->cell * nscale;
+	int i0 = floor( (bounds->x * nscale + nx) / h );
+	int j0 = floor( (bounds->y * nscale + ny) / h );
+	int oi0 = NG->i0;
+	int oj0 = NG->j0;
+	bool full = !NG->valid || h != NG->h || abs( i0 - oi0 ) >= NG->cols || abs( j0 - oj0 ) >= NG->rows;
+	NG->h = h;
+	NG->computed = 0;
+	for (int j = j0; j < j0 + NG->rows; ++j ){
+		bool new_row = full || j < oj0 || j >= oj0 + NG->rows;
+		for (int i = i0; i < i0 + NG->cols; ++i ){
+			if( new_row || i < oi0 || i >= oi0 + NG->cols ) noise_grid_fill( NG, ctx, i, j );
+		}
+	}
+	NG->i0 = i0;
+	NG->j0 = j0;
+	NG->valid = 1;
+}
+
+static inline float noise_grid_sample( noise_grid *NG, double gu, double gv ){
+	int i = floor( gu );
+	int j = floor( gv );
+	float fx = gu - i;
+	float fy = gv - j;
+	int c0 = ring( i, NG->cols ), c1 = ring( i+1, NG->cols );
+	int r0 = ring( j, NG->rows ) * NG->cols, r1 = ring( j+1, NG->rows ) * NG->cols;
+	float top = NG->val[r0+c0] + fx * (NG->val[r0+c1] - NG->val[r0+c0]);
+	float bot = NG->val[r1+c0] + fx * (NG->val[r1+c1] - NG->val[r1+c0]);
+	return top + fy * (bot - top);
+}
+
+void noise_grid_free( noise_grid *NG ){
+	free( NG->val );
+	NG->val = NULL;
+	NG->valid = 0;
+}
+
+
+// Per-frame noise field: quad_factor for polygons [a, b) of the store.
+typedef struct {
+	poly_store *PS;
+	struct osn_context *ctx;
+	struct osn_batch_context *bctx;
+	bool batched;
+	double nscale, nx, ny;
+	noise_grid *NG; // sample this instead when not NULL
+} field_job;
+
+void field_update_range( void *data, int a, int b ){
+	field_job *J = data;
+	poly_store *PS = J->PS;
+	if( J->NG ){
+		double ih = 1.0 / J->NG->h;
+		for (int i = a; i < b; ++i ){
+			float n = noise_grid_sample( J->NG, (PS->cx[i] * J->nscale + J->nx) * ih, (PS->cy[i] * J->nscale + J->ny) * ih );
+			PS->qf[i] = constrainF( n + 0.5, 0.0001, 1 );
+		}
+	}
+	else if( J->batched ){
+		open_simplex_noise2d_batch( J->bctx, PS->cx + a, PS->cy + a, b - a, J->nscale, J->nx, J->ny, PS->qf + a );
+		for (int i = a; i < b; ++i ){
+			PS->qf[i] = constrainF( PS->qf[i] + 0.5, 0.0001, 1 );
+		}
+	}
+	else{
+		for (int i = a; i < b; ++i ){
+			PS->qf[i] = open_simplex_noise2d( J->ctx, PS->cx[i] * J->nscale + J->nx, PS->cy[i] * J->nscale + J->ny );
+			PS->qf[i] = constrainF( PS->qf[i] + 0.5, 0.0001, 1 );
+		}
+	}
 }
 
+// qf ranges start on cache line boundaries (qf itself is cache_line_alloc()ed), so no two
+// threads write the same line.
+#define FIELD_ALIGN (CACHE_LINE / sizeof(float))
+
+// how far the lattice field is from exact sampling, in quad_factor units
+void noise_grid_error( poly_store *PS, noise_grid *NG, struct osn_context *ctx, double nscale, double nx, double ny,
+					   double *max_err, double *mean_err ){
+	field_job J = { PS, ctx, NULL, 0, nscale, nx, ny, NG };
+	float *grid_qf = malloc( PS->count * sizeof(float) );
+	field_update_range( &J, 0, PS->count );
+	memcpy( grid_qf, PS->qf, PS->count * sizeof(float) );
+	J.NG = NULL;
+	field_update_range( &J, 0, PS->count );
+	*max_err = 0;
+	*mean_err = 0;
+	for (int i = 0; i < PS->count; ++i ){
+		double e = fabs( grid_qf[i] - PS->qf[i] );
+		if( e > *max_err ) *max_err = e;
+		*mean_err += e;
+	}
+	if( PS->count > 0 ) *mean_err /= PS->count;
+	free( grid_qf );
+}
 
-int export_svg( regpolvec *regpols, char *filename ){
+
+// The original exporter, one fprintf'd <path> per face. Only --bench-svg still uses it.
+int export_svg_verbose( regpolvec *regpols, float *quad_factors, char *filename ){
 	
 	FILE *f = fopen( filename, "w" );
+	if( f == NULL ) return 1;
 
 	fprintf(f, "<svg>\n\n" );
 
@@ -408,6 +1274,7 @@ int export_svg( regpolvec *regpols, char *filename ){
 
 	ok_vec_foreach_ptr( regpols, regular_poly *rp ){
 
+		float qf = quad_factors[ rp->id ];
 		for (int s = 0; s < rp->sides; s++ ){
 			fprintf(f, "   <path\n" );
 			switch( rp->sides ){
@@ -420,8 +1287,8 @@ int export_svg( regpolvec *regpols, char *filename ){
 			int ns = s+1;
 			if( ns >= rp->sides ) ns = 0;
 			fprintf(f, "%lg,%lg ", rp->center.x +                  rp->G->V[s].x,  rp->center.y +                  rp->G->V[s].y  );
-			fprintf(f, "%lg,%lg ", rp->center.x + rp->quad_factor * rp->G->V[s].x,  rp->center.y + rp->quad_factor * rp->G->V[s].y  );
-			fprintf(f, "%lg,%lg ", rp->center.x + rp->quad_factor * rp->G->V[ns].x, rp->center.y + rp->quad_factor * rp->G->V[ns].y );
+			fprintf(f, "%lg,%lg ", rp->center.x + qf * rp->G->V[s].x,  rp->center.y + qf * rp->G->V[s].y  );
+			fprintf(f, "%lg,%lg ", rp->center.x + qf * rp->G->V[ns].x, rp->center.y + qf * rp->G->V[ns].y );
 			fprintf(f, "%lg,%lg ", rp->center.x +                  rp->G->V[ns].x, rp->center.y +                  rp->G->V[ns].y );
 			
 			fprintf(f, "z\"\n" );
@@ -448,73 +1315,387 @@ int export_svg( regpolvec *regpols, char *filename ){
 
 
 
-int main(int argc, char *argv[]){
-
-	srand (time(NULL));
-	char buf [256];
+// Streaming SVG output: everything goes through one large buffer, numbers are formatted
+// by hand at a fixed number of decimals (trailing zeros dropped), and no memory is
+// allocated per face.
+#define SVG_BUFFER (1 << 20)
 
-	//HWND hwnd_win = GetConsoleWindow();
-	//ShowWindow(hwnd_win,SW_HIDE);
-	SDL_Window *window;
-	SDL_Renderer *rend;
-	int width, height;
-	bool loop = 1;
-	vec2d mouse = v2dzero;
-	vec2d pmouse = v2dzero;
+typedef struct {
+	FILE *f;
+	int len;
+	double mult; // 10^decimals
+	int decimals;
+	char buf [SVG_BUFFER];
+} svg_writer;
 
+static void svg_flush( svg_writer *W ){
+	fwrite( W->buf, 1, W->len, W->f );
+	W->len = 0;
+}
 
-	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s", SDL_GetError());
-		return 3;
+static inline void svg_put( svg_writer *W, const char *str, int n ){
+	if( W->len + n > SVG_BUFFER ){
+		svg_flush( W );
+		if( n > SVG_BUFFER ){
+			fwrite( str, 1, n, W->f );
+			return;
+		}
 	}
+	memcpy( W->buf + W->len, str, n );
+	W->len += n;
+}
 
-	if (SDL_CreateWindowAndRenderer(1, 1, SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED, &window, &rend)) {
-		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create window and renderer: %s", SDL_GetError());
-		return 3;
+static inline void svg_puts( svg_writer *W, const char *str ){
+	svg_put( W, str, strlen(str) );
+}
+
+static inline void svg_putc( svg_writer *W, char c ){
+	if( W->len >= SVG_BUFFER ) svg_flush( W );
+	W->buf[ W->len++ ] = c;
+}
+
+static void svg_put_number( svg_writer *W, double v ){
+	char tmp [32];
+	int n = 0;
+	long long q = llround( v * W->mult );
+	bool neg = q < 0;
+	if( neg ) q = -q;
+	int d = W->decimals;
+	// drop trailing zeros of the fraction
+	while( d > 0 && q % 10 == 0 ){
+		q /= 10;
+		d--;
 	}
-	SDL_SetRenderDrawBlendMode( rend, SDL_BLENDMODE_BLEND );
-	//SDL_MaximizeWindow( window );
-	SDL_SetWindowTitle( window, "Tecniquim 00" );
-	SDL_GetWindowSize( window, &width, &height );
-	int cx = width/2;
-	int cy = height/2;
+	// digits, backwards
+	do {
+		tmp[n++] = '0' + q % 10;
+		q /= 10;
+		if( --d == 0 ) tmp[n++] = '.';
+	} while( q > 0 || d >= 0 );
+	if( neg ) tmp[n++] = '-';
+	if( W->len + n > SVG_BUFFER ) svg_flush( W );
+	for (int i = n-1; i >= 0; --i ) W->buf[ W->len++ ] = tmp[i];
+}
 
-	IMG_Init(IMG_INIT_PNG);
-	//SDL_Surface *icon = IMG_Load( "icon32.png" );
-	//SDL_SetWindowIcon( window, icon );
+static void svg_put_point( svg_writer *W, double x, double y ){
+	svg_put_number( W, x );
+	svg_putc( W, ',' );
+	svg_put_number( W, y );
+}
 
-	
+static void svg_put_color( svg_writer *W, Uint32 rgb ){
+	static const char hex [] = "0123456789ABCDEF";
+	char c [7] = { '#' };
+	for (int i = 0; i < 6; ++i ) c[1+i] = hex[ (rgb >> (20 - 4*i)) & 15 ];
+	svg_put( W, c, 7 );
+}
 
+// one face as a subpath, same corners as export_svg_verbose()
+static void svg_put_face( svg_writer *W, regular_poly *rp, float qf, int s ){
+	int ns = s+1;
+	if( ns >= rp->sides ) ns = 0;
+	svg_putc( W, 'M' );
+	svg_put_point( W, rp->center.x +      rp->G->V[s].x,  rp->center.y +      rp->G->V[s].y  );
+	svg_putc( W, ' ' );
+	svg_put_point( W, rp->center.x + qf * rp->G->V[s].x,  rp->center.y + qf * rp->G->V[s].y  );
+	svg_putc( W, ' ' );
+	svg_put_point( W, rp->center.x + qf * rp->G->V[ns].x, rp->center.y + qf * rp->G->V[ns].y );
+	svg_putc( W, ' ' );
+	svg_put_point( W, rp->center.x +      rp->G->V[ns].x, rp->center.y +      rp->G->V[ns].y );
+	svg_putc( W, 'z' );
+}
 
-	struct config *CFG;
+// Same drawing as export_svg_verbose() in far fewer bytes: coordinates at `decimals`
+// places, one short <path> per face, or with `merge` a single <path> per fill color
+// holding all its faces as subpaths. Returns 0 on success.
+int export_svg( regpolvec *regpols, float *quad_factors, char *filename, int decimals, bool merge ){
 
-	cyaml_err_t err = cyaml_load_file( "config.yaml", &cyamlconfig, &top_schema, 
-									   (cyaml_data_t **)&CFG, NULL );
-	if (err != CYAML_OK) {
-		printf("CYAML ERROR: %d\n", err );
-		abort();
+	svg_writer *W = malloc( sizeof(svg_writer) );
+	W->f = fopen( filename, "wb" );
+	if( W->f == NULL ){
+		free( W );
+		return 1;
+	}
+	W->len = 0;
+	W->decimals = max( 0, min( decimals, 6 ) );
+	W->mult = pow( 10, W->decimals );
+
+	svg_puts( W, "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:inkscape=\"http://www.inkscape.org/namespaces/inkscape\">\n"
+	             "<g inkscape:groupmode=\"layer\" id=\"layer1\" inkscape:label=\"bg\">"
+	             "<rect style=\"fill:#000000;stroke:none\" id=\"bg_rect\" width=\"3240\" height=\"2075\" x=\"-240\" y=\"-330\"/></g>\n"
+	             "<g inkscape:groupmode=\"layer\" id=\"layer2\" inkscape:label=\"geometry\" stroke=\"none\">\n" );
+
+	if( !merge ){
+		ok_vec_foreach_ptr( regpols, regular_poly *rp ){
+			float qf = quad_factors[ rp->id ];
+			for (int s = 0; s < rp->sides; s++ ){
+				svg_puts( W, "<path fill=\"" );
+				svg_put_color( W, SDL_Color_to_Uint32( rp->color[s] ) >> 8 );
+				svg_puts( W, "\" d=\"" );
+				svg_put_face( W, rp, qf, s );
+				svg_puts( W, "\"/>\n" );
+			}
+		}
+	}
+	else{
+		// faces bucketed by color, counting sort on the color table. The table is searched
+		// from the last color found, which is almost always the next face's too.
+		struct ok_vec_of(Uint32) colors;
+		ok_vec_init( &colors );
+		int faces = 0;
+		ok_vec_foreach_ptr( regpols, regular_poly *rp ) faces += rp->sides;
+		int *face_color = malloc( max( faces, 1 ) * sizeof(int) );
+		int k = 0, last = 0;
+		ok_vec_foreach_ptr( regpols, regular_poly *rp ){
+			for (int s = 0; s < rp->sides; s++, k++ ){
+				Uint32 c = SDL_Color_to_Uint32( rp->color[s] ) >> 8;
+				int ci = last;
+				if( ci >= ok_vec_count( &colors ) || ok_vec_get( &colors, ci ) != c ){
+					ci = 0;
+					while( ci < ok_vec_count( &colors ) && ok_vec_get( &colors, ci ) != c ) ci++;
+					if( ci == ok_vec_count( &colors ) ) ok_vec_push( &colors, c );
+				}
+				face_color[k] = last = ci;
+			}
+		}
+		int color_count = ok_vec_count( &colors );
+		int *start = calloc( color_count + 1, sizeof(int) );
+		for (k = 0; k < faces; ++k ) start[ face_color[k] + 1 ]++;
+		for (int c = 0; c < color_count; ++c ) start[c+1] += start[c];
+		// (polygon, side) of each face, in color order
+		int *order = malloc( max( faces, 1 ) * 2 * sizeof(int) );
+		int *fill = malloc( max( color_count, 1 ) * sizeof(int) );
+		memcpy( fill, start, color_count * sizeof(int) );
+		k = 0;
+		for (int r = 0; r < ok_vec_count( regpols ); ++r ){
+			regular_poly *rp = ok_vec_get_ptr( regpols, r );
+			for (int s = 0; s < rp->sides; s++, k++ ){
+				int o = fill[ face_color[k] ]++;
+				order[2*o] = r;
+				order[2*o+1] = s;
+			}
+		}
+		for (int c = 0; c < color_count; ++c ){
+			svg_puts( W, "<path fill=\"" );
+			svg_put_color( W, ok_vec_get( &colors, c ) );
+			svg_puts( W, "\" d=\"" );
+			for (int o = start[c]; o < start[c+1]; ++o ){
+				regular_poly *rp = ok_vec_get_ptr( regpols, order[2*o] );
+				svg_put_face( W, rp, quad_factors[ rp->id ], order[2*o+1] );
+			}
+			svg_puts( W, "\"/>\n" );
+		}
+		ok_vec_deinit( &colors );
+		free( face_color );
+		free( start );
+		free( order );
+		free( fill );
 	}
 
-	
-	SDL_Color edge_color = Uint32_to_SDL_Color( CFG->edge_color );
-	CFG->edge_thickness = CFG->edge_thickness * CFG->AAx * 0.5;
+	svg_puts( W, "</g>\n</svg>" );
+	svg_flush( W );
+	int ret = ferror( W->f )? 1 : 0;
+	fclose( W->f );
+	free( W );
+	return ret;
+}
 
-	sprintf( buf, "data/%s", CFG->palette );
-	SDL_Surface *palsurf = IMG_Load( buf );
-	CFG->palette_count = palsurf->w;
-	Uint32 *palpix = (Uint32*) palsurf->pixels;
-	SDL_Color *palette = malloc( CFG->palette_count * sizeof(SDL_Color) );
-	for (int i = 0; i < CFG->palette_count; ++i ){
-		//printf("palpix[i]: %08X\n", palpix[i] );
-		palette[i] = Uint32_to_SDL_Color( palpix[i] );
+
+
+// A <defs> entry of export_svg_instanced(): one prototype ring at one quantized
+// quad_factor in one set of face colors.
+typedef struct {
+	geo *G;
+	int sides;
+	int level;
+	SDL_Color *color;
+} svg_symbol;
+
+static inline Uint32 svg_symbol_hash( geo *G, int level, SDL_Color *color ){
+	uintptr_t h = (uintptr_t)G * 31 + (uintptr_t)color * 17 + level;
+	h ^= h >> 16;
+	h *= 0x7feb352d;
+	h ^= h >> 15;
+	return (Uint32)h;
+}
+
+// Same drawing as export_svg(), but every ring shape is written once in <defs> and each
+// polygon is a <use> of it moved to its center. quad_factor is rounded to one of `levels`
+// steps, which is what lets polygons share a ring. Returns 0 on success.
+int export_svg_instanced( regpolvec *regpols, float *quad_factors, char *filename, int decimals, int levels ){
+
+	svg_writer *W = malloc( sizeof(svg_writer) );
+	W->f = fopen( filename, "wb" );
+	if( W->f == NULL ){
+		free( W );
+		return 1;
+	}
+	W->len = 0;
+	W->decimals = max( 0, min( decimals, 6 ) );
+	W->mult = pow( 10, W->decimals );
+	if( levels < 2 ) levels = 2;
+
+	// symbol of each polygon, -1 where the ring is empty; open addressing on (geo, level, colors)
+	int N = ok_vec_count( regpols );
+	int *sym = malloc( max( N, 1 ) * sizeof(int) );
+	int cap = 1024, count = 0;
+	svg_symbol *symbols = malloc( cap * sizeof(svg_symbol) );
+	int mask = 4095;
+	int *table = malloc( (mask+1) * sizeof(int) );
+	memset( table, -1, (mask+1) * sizeof(int) );
+	for (int r = 0; r < N; ++r ){
+		regular_poly *rp = ok_vec_get_ptr( regpols, r );
+		sym[r] = -1;
+		// an empty ring only at qf 1, like gp_quadpoly(); rounding up to it mustn't drop a polygon
+		if( quad_factors[ rp->id ] >= 1 ) continue;
+		int level = lrintf( constrainF( quad_factors[ rp->id ], 0, 1 ) * (levels-1) );
+		level = min( level, levels-2 );
+		Uint32 h = svg_symbol_hash( rp->G, level, rp->color ) & mask;
+		while( table[h] >= 0 ){
+			svg_symbol *S = symbols + table[h];
+			if( S->G == rp->G && S->level == level && S->color == rp->color ) break;
+			h = (h+1) & mask;
+		}
+		if( table[h] < 0 ){
+			if( count == cap ){
+				cap *= 2;
+				symbols = realloc( symbols, cap * sizeof(svg_symbol) );
+			}
+			symbols[count] = (svg_symbol){ rp->G, rp->sides, level, rp->color };
+			table[h] = count++;
+			if( 2 * count > mask ){
+				// rehash at half load
+				mask = 2 * mask + 1;
+				table = realloc( table, (mask+1) * sizeof(int) );
+				memset( table, -1, (mask+1) * sizeof(int) );
+				for (int i = 0; i < count; ++i ){
+					Uint32 g = svg_symbol_hash( symbols[i].G, symbols[i].level, symbols[i].color ) & mask;
+					while( table[g] >= 0 ) g = (g+1) & mask;
+					table[g] = i;
+				}
+			}
+		}
+		sym[r] = table[h];
 	}
-	int palW = 30;
-	int palY = (height - (CFG->palette_count * palW))/2;
 
-	SDL_Color Z = {0,0,0,0};
-	/*
-		Uint32 tripal [3] =   { 0x019bcdff, 0x98a4b7ff, 0x252b44ff };
-		Uint32 tetrapal [4] = { 0x047eb9ff, 0xdcdee1ff, 0x5f6d88ff, 0x1f2238ff };
+	svg_puts( W, "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" "
+	             "xmlns:inkscape=\"http://www.inkscape.org/namespaces/inkscape\">\n"
+	             "<defs>\n" );
+	for (int i = 0; i < count; ++i ){
+		svg_symbol *S = symbols + i;
+		double qf = S->level / (double)(levels-1);
+		char id [16];
+		snprintf( id, 16, "<g id=\"r%d\">", i );
+		svg_puts( W, id );
+		for (int s = 0; s < S->sides; s++ ){
+			int ns = s+1;
+			if( ns >= S->sides ) ns = 0;
+			svg_puts( W, "<path fill=\"" );
+			svg_put_color( W, SDL_Color_to_Uint32( S->color[s] ) >> 8 );
+			svg_puts( W, "\" d=\"M" );
+			svg_put_point( W,      S->G->V[s].x,       S->G->V[s].y  );
+			svg_putc( W, ' ' );
+			svg_put_point( W, qf * S->G->V[s].x,  qf * S->G->V[s].y  );
+			svg_putc( W, ' ' );
+			svg_put_point( W, qf * S->G->V[ns].x, qf * S->G->V[ns].y );
+			svg_putc( W, ' ' );
+			svg_put_point( W,      S->G->V[ns].x,      S->G->V[ns].y );
+			svg_puts( W, "z\"/>" );
+		}
+		svg_puts( W, "</g>\n" );
+	}
+	svg_puts( W, "</defs>\n"
+	             "<g inkscape:groupmode=\"layer\" id=\"layer1\" inkscape:label=\"bg\">"
+	             "<rect style=\"fill:#000000;stroke:none\" id=\"bg_rect\" width=\"3240\" height=\"2075\" x=\"-240\" y=\"-330\"/></g>\n"
+	             "<g inkscape:groupmode=\"layer\" id=\"layer2\" inkscape:label=\"geometry\" stroke=\"none\">\n" );
+	for (int r = 0; r < N; ++r ){
+		if( sym[r] < 0 ) continue;
+		regular_poly *rp = ok_vec_get_ptr( regpols, r );
+		char head [32];
+		svg_put( W, head, snprintf( head, 32, "<use xlink:href=\"#r%d\" x=\"", sym[r] ) );
+		svg_put_number( W, rp->center.x );
+		svg_puts( W, "\" y=\"" );
+		svg_put_number( W, rp->center.y );
+		svg_puts( W, "\"/>\n" );
+	}
+	svg_puts( W, "</g>\n</svg>" );
+	svg_flush( W );
+	int ret = ferror( W->f )? 1 : 0;
+	fclose( W->f );
+	free( W );
+	free( sym );
+	free( symbols );
+	free( table );
+	return ret;
+}
+
+// Exports with whichever SVG writer and settings the config asks for.
+int export_svg_config( struct config *CFG, regpolvec *regpols, float *quad_factors, char *filename ){
+	if( CFG->svg_instances ){
+		return export_svg_instanced( regpols, quad_factors, filename, CFG->svg_decimals, CFG->svg_levels );
+	}
+	return export_svg( regpols, quad_factors, filename, CFG->svg_decimals, CFG->svg_merge );
+}
+
+
+
+typedef struct ok_vec_of(geo) geovec;
+typedef struct ok_map_of( const char*, geo* ) geomap;
+
+// Loads config.yaml-style settings, NULL on error.
+struct config *load_config( const char *filename ){
+	struct config *CFG;
+	cyaml_err_t err = cyaml_load_file( filename, &cyamlconfig, &top_schema, (cyaml_data_t **)&CFG, NULL );
+	if (err != CYAML_OK) {
+		printf("CYAML ERROR: %d\n", err );
+		return NULL;
+	}
+	if( CFG->svg_decimals <= 0 ) CFG->svg_decimals = 2;
+	if( CFG->svg_levels <= 1 ) CFG->svg_levels = 64;
+	if( CFG->tiling_cache == NULL ){
+		CFG->tiling_cache = malloc( 6 );
+		strcpy( CFG->tiling_cache, "cache" );
+	}
+	return CFG;
+}
+
+
+typedef struct {
+	SDL_Color *palette; // one color per pixel of data/<CFG->palette>
+	SDL_Color (*solid) [12]; // each palette color for all 12 faces, what painting assigns
+	SDL_Color tri [3]; 
+	SDL_Color tetra [4];
+	SDL_Color hexa [6];
+	SDL_Color dodec [12];
+	SDL_Color *by_sides [13]; // face colors for each polygon type
+} palettes;
+
+// Fills CFG->palette_count too. Returns 0 if the palette image can't be read.
+bool load_palettes( palettes *PAL, struct config *CFG ){
+
+	char buf [256];
+	sprintf( buf, "data/%s", CFG->palette );
+	SDL_Surface *palsurf = IMG_Load( buf );
+	if( palsurf == NULL ){
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "IMG_Load error: %s", IMG_GetError() );
+		return 0;
+	}
+	CFG->palette_count = palsurf->w;
+	Uint32 *palpix = (Uint32*) palsurf->pixels;
+	PAL->palette = malloc( CFG->palette_count * sizeof(SDL_Color) );
+	for (int i = 0; i < CFG->palette_count; ++i ){
+		//printf("palpix[i]: %08X\n", palpix[i] );
+		PAL->palette[i] = Uint32_to_SDL_Color( palpix[i] );
+	}
+	SDL_FreeSurface( palsurf );
+	PAL->solid = malloc( CFG->palette_count * sizeof(SDL_Color[12]) );
+	for (int i = 0; i < CFG->palette_count; ++i ){
+		for (int s = 0; s < 12; ++s ) PAL->solid[i][s] = PAL->palette[i];
+	}
+
+	/*
+		Uint32 tripal [3] =   { 0x019bcdff, 0x98a4b7ff, 0x252b44ff };
+		Uint32 tetrapal [4] = { 0x047eb9ff, 0xdcdee1ff, 0x5f6d88ff, 0x1f2238ff };
 		Uint32 hexapal [6] =  { 0x0a649dff, 0x56d3e1ff, 0xc7cbd5ff, 0x717f97ff, 0x363f5dff, 0x19192bff 
 		for (int i = 0; i < 3; ++i ) tri_palette[i] = Uint23_to_SDL_Color( tripal[i] );
 		for (int i = 0; i < 4; ++i ) tetra_palette[i] = Uint23_to_SDL_Color( tetrapal[i] );
@@ -532,386 +1713,2482 @@ int main(int argc, char *argv[]){
 	//Uint32 pal [12] = {0xeaeaeaff, 0x151515ff, 0x808080ff, 0x151515ff, 0xeaeaeaff, 0x808080ff,
 	//						 0xeaeaeaff, 0x151515ff, 0x808080ff, 0x151515ff, 0xeaeaeaff, 0x808080ff };
 
+	/*for (int i = 0; i < 12; ++i ){
+		if( i < 3  ) tri_palette  [i] = Uint23_to_SDL_Color( pal[i] );
+		if( i < 4  ) tetra_palette[i] = Uint23_to_SDL_Color( pal[i] );
+		if( i < 6  ) hexa_palette [i] = Uint23_to_SDL_Color( pal[i] );
+		if( i < 12 ) dodec_palette[i] = Uint23_to_SDL_Color( pal[i] );
+	}*/
+	
+	for (int i = 0; i < 3; ++i ) PAL->tri[i] = lerp_through_array( pal, paln, (1 + (2*i)) / 6.0 );
+	for (int i = 0; i < 4; ++i ) PAL->tetra[i] = lerp_through_array( pal, paln, (1 + (2*i)) / 8.0 );
+	for (int i = 0; i < 6; ++i ) PAL->hexa[i] = lerp_through_array( pal, paln, (1 + (2*i)) / 12.0 );
+	for (int i = 0; i < 12; ++i ) PAL->dodec[i] = lerp_through_array( pal, paln, (1 + (2*i)) / 24.0 );
+
+	for (int i = 0; i < 13; ++i ) PAL->by_sides[i] = PAL->palette;
+	PAL->by_sides[3] = PAL->tri;
+	PAL->by_sides[4] = PAL->tetra;
+	PAL->by_sides[6] = PAL->hexa;
+	PAL->by_sides[12] = PAL->dodec;
+	return 1;
+}
+
+
+// splitmix64, for code that can't share rand() (the poster farm's jobs each own one).
+Uint64 rng_next( Uint64 *state ){
+	Uint64 z = (*state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+// uniform in [a, b)
+double rng_uniform( Uint64 *state, double a, double b ){
+	return a + (b - a) * ((rng_next( state ) >> 11) * (1.0 / 9007199254740992.0));
+}
+
+// The tesselation named `code`, or for "RANDOM" a random one tagged nice, cool or fun
+// and not bad, drawn from rng, or from random() if rng is NULL. NULL if nothing matches.
+Tess *find_tesselation( Tess *tesselations, int tesselations_count, const char *code, Uint64 *rng ){
+
+	Tess *TT = NULL;
+	if( strcmp( "RANDOM", code ) == 0 ){
+
+		int sel_count = 0;
+		for (int i = 0; i < tesselations_count; ++i ){
+			if( (strcchr( tesselations[i].tags, 'N' ) || //nice
+				 strcchr( tesselations[i].tags, 'C' ) || //cool
+				 strcchr( tesselations[i].tags, 'F' ))&& //fun
+				 strcchr( tesselations[i].tags, 'B' ) == 0 ){// Bad
+
+				sel_count++;
+			}
+		}
+		if( sel_count == 0 ) return NULL;
+		int T = rng? 1 + rng_next( rng ) % sel_count : random(0, sel_count);
+		for (int i = 0; i < tesselations_count; ++i ){
+			if( (strcchr( tesselations[i].tags, 'N' ) || //nice
+				 strcchr( tesselations[i].tags, 'C' ) || //cool
+				 strcchr( tesselations[i].tags, 'F' ))&& //fun
+				 strcchr( tesselations[i].tags, 'B' ) == 0 ){// Bad
+
+				if( --T == 0 ){
+					TT = tesselations + i;
+					break;
+				}
+			}
+		}
+		//TT = tesselations + random(0, tesselations_count);
+	}
+	else{
+		for (int i = 0; i < tesselations_count; ++i ){
+			if( strcmp( tesselations[i].name, code ) == 0 ){
+				TT = tesselations + i;
+				printf("grabbing tesselations[%d]\n", i );
+				break;
+			}
+		}
+	}
+	return TT;
+}
+
+
+
+double seconds_since( Uint64 t0 ){
+	return (SDL_GetPerformanceCounter() - t0) / (double) SDL_GetPerformanceFrequency();
+}
+
+// The polygons of one tesselation covering a width x height window drawn at AAx
+// supersampling, with their prototypes and picking zones.
+typedef struct {
+
+	int width, height, AAx;
+	double scale;
+	Transform T;
+	SDL_Rect bounds; // the AA target plus one scale unit all around
+
+	regpolvec regpols;
+	geovec geov;
+	str_vec geo_codes;
+	geomap geom;
+	zone_grid zones;
+	float smallest_radius;
+
+	// optional: threads for build_tiling(), NULL builds on the calling thread
+	thread_pool *pool;
+	// optional, called from build_tiling() every so often with how many polygons are done
+	void (*progress)( void *data, int count );
+	void *progress_data;
+	// optional, build_tiling() gives up between chunks once this is set
+	SDL_atomic_t *cancel;
+	// seconds spent in each phase of the last build
+	double t_lattice, t_faces, t_zones;
+
+} tiling;
+
+#define TILING_MAX_GEOS 10
+
+void tiling_init( tiling *TL, int width, int height, double scale, int AAx ){
+
+	TL->width = width;
+	TL->height = height;
+	TL->AAx = AAx;
+	TL->scale = scale;
+	TL->T = (Transform){ 0, 0, 0, 0, 1, 1 };
+	set_scale( &(TL->T), scale * AAx );
+	TL->bounds = (SDL_Rect){ -TL->T.s, -TL->T.s, 
+							 (AAx * width)  + 2*(TL->T.s), 
+							 (AAx * height) + 2*(TL->T.s) };
+	//{ 50, 50, (CFG->AAx * width)-100, (CFG->AAx * height)-100 };
+
+	ok_vec_init(&(TL->regpols));
+	ok_vec_init(&(TL->geov));
+	// geo pointers are handed out from here, it must never reallocate: 4 triangles, 3 squares, 2 hexagons, 1 dodecagon.
+	ok_vec_ensure_capacity(&(TL->geov), TILING_MAX_GEOS);
+	ok_vec_init(&(TL->geo_codes));
+	ok_map_init(&(TL->geom));
+	TL->zones = (zone_grid){0};
+	TL->smallest_radius = 9999999;
+	TL->pool = NULL;
+	TL->progress = NULL;
+	TL->progress_data = NULL;
+	TL->cancel = NULL;
+	TL->t_lattice = 0;
+	TL->t_faces = 0;
+	TL->t_zones = 0;
+}
+
+//Registering polygons into zones (again, if they were already):
+void tiling_zones( tiling *TL ){
+	zone_grid_free( &(TL->zones) );
+	int zone_cols, zone_rows;
+	zone_grid_dims( &(TL->bounds), ok_vec_count(&(TL->regpols)), TL->smallest_radius, &zone_cols, &zone_rows );
+	zone_grid_build( &(TL->zones), &(TL->regpols), &(TL->bounds), zone_cols, zone_rows, TL->T.s );
+}
+
+// Adds the prototype for sides:angle_id, unless it's there already.
+geo *tiling_geo( tiling *TL, int sides, int angle_id ){
+	char buf [32];
+	sprintf( buf, "%d:%d", sides, angle_id );
+	geo* G = ok_map_get(&(TL->geom), buf);
+	if( G == NULL ){
+		//printf("neogeo: [%s]\n", buf );
+		G = ok_vec_push_new(&(TL->geov));
+		double angle = angle_from_id( sides, angle_id );
+		float radius = TL->T.s * radii[ sides ];
+		if( radius < TL->smallest_radius ) TL->smallest_radius = radius;
+		geo_init( G, sides, angle, radius );
+		char *str = malloc( strlen(buf)+1 );
+		strcpy( str, buf );
+		ok_vec_push(&(TL->geo_codes), str);
+		ok_map_put( &(TL->geom), *ok_vec_last(&(TL->geo_codes)), G );
+	}
+	return G;
+}
+
+//                                       2  3  4   5
+static const int tiling_polytype [] = { -1, -1, 3, 4, 6, 12 };
+
+// A face seen from its vertex C, between the edges to the neighbors in directions
+// d and d + diff (d < 6), walks dir12[d], dir12[d + 12/sides], ... back to C. These are
+// the sum of its vertices minus sides * C, and its breakdown_regpol_angle() id,
+// both by [diff][d]: the face's orientation only depends on where its first edge points.
+static const Wcoord face_vertex_sum [6][6] = {
+	{ {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}} },
+	{ {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}}, {{ 0, 0, 0, 0}} },
+	{ {{  1,  0,  1,  0}}, {{  0,  1,  0,  1}}, {{ -1,  0,  2,  0}}, {{  0, -1,  0,  2}}, {{ -2,  0,  1,  0}}, {{  0, -2,  0,  1}} },
+	{ {{  2,  0,  0,  2}}, {{ -2,  2,  2,  0}}, {{  0, -2,  2,  2}}, {{ -2,  0,  0,  2}}, {{ -2, -2,  2,  0}}, {{  0, -2, -2,  2}} },
+	{ {{  0,  0,  6,  0}}, {{  0,  0,  0,  6}}, {{ -6,  0,  6,  0}}, {{  0, -6,  0,  6}}, {{ -6,  0,  0,  0}}, {{  0, -6,  0,  0}} },
+	{ {{  0,  0, 12, 12}}, {{-12,  0, 12, 12}}, {{-12,-12, 12, 12}}, {{-12,-12,  0, 12}}, {{-12,-12,  0,  0}}, {{  0,-12,-12,  0}} },
+};
+static const int face_angle_id [6][6] = {
+	{ -1, -1, -1, -1, -1, -1 },
+	{ -1, -1, -1, -1, -1, -1 },
+	{  3,  0,  1,  2,  3,  0 }, // triangles: every 4 directions (120 degrees)
+	{  1,  2,  0,  1,  2,  0 }, // squares: every 3 (90)
+	{  0,  1,  0,  1,  0,  1 }, // hexagons: every 2 (60)
+	{  0,  0,  0,  0,  0,  0 }, // dodecagons
+};
+
+// A face as found from one of its vertices, before it's known whether an earlier row has it.
+typedef struct {
+	Wcoord key; // 12 * centroid
+	vec2d center;
+	int sides, angle;
+} face_candidate;
+
+typedef struct {
+	struct ok_vec_of(face_candidate) found;
+	wc_set seen;
+	int raw;
+} face_row;
+
+// Finds the faces around the seeds of lattice cell x, y that are in bounds and that
+// this row hasn't found already. Only reads TL and the lattice.
+static void tiling_cell( tiling *TL, Tess *TT, wc_set *hash, face_row *R, int x, int y ){
+
+	const int *polytype = tiling_polytype;
+	Transform *T = &(TL->T);
+	SDL_Rect *bounds = &(TL->bounds);
+
+	Wcoord trans = wc_sum( wc_scaled( TT->T1, x ), wc_scaled( TT->T2, y ) );
+	for (int s = 0; s < TT->seed_count; s++) {
+		Wcoord C = wc_plus_warr( TT->seed[s], trans );
+		int face = 0;
+		int neighs [12];
+		for ( int d = 0; d < 6; d++ ) {
+			Wcoord neighbor = wc_sum( C, dir12[d] );
+			if( wc_set_get( hash, neighbor ) ){
+				//putchar('>');
+				neighs[ face++ ] = d;
+			}
+		}
+
+		for( int n = 0; n < face-1; n++ ){
+
+			// everything stays in integer Wcoords, exact, up to the screen transform
+			int diff = neighs[n+1] - neighs[n];
+			int sides = polytype[diff];
+			Wcoord fsum = wc_sum( wc_scaled( C.w, sides ), face_vertex_sum[diff][ neighs[n] ] );
+			vec2d centroid = wc_to_v2d( fsum );
+			v2d_mult( &(centroid), 1.0 / sides );
+			vec2d tcen = apply_transform_v2d( &(centroid), T );
+
+			if( coordinates_in_Rect( tcen.x, tcen.y, bounds ) ){
+				// every vertex of a face discovers it; only the first one gets to keep it.
+				// 12 * centroid is an exact integer Wcoord, and faces never share centroids.
+				R->raw++;
+				Wcoord key = wc_scaled( fsum.w, 12 / sides );
+				if( wc_set_get( &(R->seen), key ) ) continue;
+				wc_set_put( &(R->seen), key, 1 );
+
+				face_candidate *F = ok_vec_push_new(&(R->found));
+				F->key = key;
+				F->sides = sides;
+				F->center = tcen;
+				F->angle = face_angle_id[diff][ neighs[n] ];
+			}
+		}
+	}
+}
+
+typedef struct {
+	tiling *TL;
+	Tess *TT;
+	wc_set *hash;
+	int HN;
+	int *rows; // translation rows of this chunk, in merge order
+	face_row *out;
+} face_job;
+
+static void face_rows( void *data, int a, int b ){
+	face_job *FJ = data;
+	for (int r = a; r < b; ++r ){
+		face_row *R = FJ->out + r;
+		ok_vec_clear( &(R->found) );
+		wc_set_init( &(R->seen), 2 * FJ->HN * FJ->TT->seed_count );
+		R->raw = 0;
+		for ( int y = -FJ->HN; y < FJ->HN; y++ ) {
+			tiling_cell( FJ->TL, FJ->TT, FJ->hash, R, FJ->rows[r], y );
+		}
+		wc_set_deinit( &(R->seen) );
+	}
+}
+
+// Expands TT over the bounds, keeping each face once, then bins the faces into zones.
+// Translation rows are visited outward from the one under the middle of the window,
+// so whatever TL->progress gets handed first is what's in view. Rows are searched
+// in chunks on TL->pool, each into its own buffer; the buffers are then merged in
+// row order, so regpols comes out the same whatever the thread count.
+// Returns -1 if TL->cancel was set, with regpols partial and no zones.
+int build_tiling( tiling *TL, Tess *TT, SDL_Color **side_palette ){
+
+	Transform *T = &(TL->T);
+
+	printf("TT: %s, seed_count: %d\n", TT->name, TT->seed_count );
+
+	wc_set hash;
+	wc_set faces;
+	int raw_faces = 0;
+
+	vec2d bbmin = v2d( 999999,  999999);
+	vec2d bbmax = v2d(-999999, -999999);
+	for (int s = 0; s < TT->seed_count; s++) {
+		vec2d v = warr_to_v2d( TT->seed[s] );
+		if( v.x < bbmin.x ) bbmin.x = v.x;
+		if( v.y < bbmin.y ) bbmin.y = v.y;
+		if( v.x > bbmax.x ) bbmax.x = v.x;
+		if( v.y > bbmax.y ) bbmax.y = v.y;
+	}
+	vec2d bb = v2d_diff( bbmax, bbmin );
+	int WN = ceil( 6 * (TL->width  / (bb.x * TL->scale)) );
+	int HN = ceil( 6 * (TL->height / (bb.y * TL->scale)) );
+	//printf(">%d, %d\n", WN, HN );
+
+	vec2d vT1 = warr_to_v2d( TT->T1 );
+	vec2d vT2 = warr_to_v2d( TT->T2 );
+	vec2d vtt = v2d_sum( vT1, vT2 );
+	int tWN = ceil( 6 * (TL->width  / (vtt.x * TL->scale)) );
+	int tHN = ceil( 6 * (TL->height / (vtt.y * TL->scale)) );
+	//printf(">%d, %d\n", tWN, tHN );
+
+	WN = max( WN, tWN );
+	HN = max( HN, tHN );
+	printf("WN:%d, HN:%d\n", WN, HN );
+	if( WN < 24 ) WN = HN;
+	if( HN < 24 ) HN = WN;
+	if( WN < 24 ) WN = 24;
+	if( HN < 24 ) HN = 24;
+	printf("WN:%d, HN:%d\n", WN, HN );
+
+	Uint64 t0 = SDL_GetPerformanceCounter();
+	build_lattice( &hash, TT, WN, HN, TL->pool );
+	TL->t_lattice = seconds_since( t0 );
+	printf("lattice points: %d\n", hash.count );
+	wc_set_init( &faces, hash.count );
+
+	// the row whose translation lands closest to the middle of the AA target, then its neighbors
+	vec2d mid = v2d( (0.5 * TL->AAx * TL->width  - T->cx) * T->invs,
+	                 (0.5 * TL->AAx * TL->height - T->cy) * T->invs );
+	double det = vT1.x * vT2.y - vT1.y * vT2.x;
+	int x0 = lrint( (mid.x * vT2.y - mid.y * vT2.x) / det );
+	x0 = max( -WN, min( WN-1, x0 ) );
+	int *rows = malloc( 2 * WN * sizeof(int) );
+	int row_count = 0;
+	rows[ row_count++ ] = x0;
+	for (int d = 1; row_count < 2*WN; ++d ){
+		if( x0 + d <  WN ) rows[ row_count++ ] = x0 + d;
+		if( x0 - d >= -WN ) rows[ row_count++ ] = x0 - d;
+	}
+
+	int chunk = ( TL->pool != NULL )? 4 * (TL->pool->workers + 1) : 1;
+	face_row *out = malloc( chunk * sizeof(face_row) );
+	for (int r = 0; r < chunk; ++r ) ok_vec_init( &(out[r].found) );
+
+	t0 = SDL_GetPerformanceCounter();
+	Uint64 shown = t0;
+	bool cancelled = false;
+	for (int c = 0; c < row_count; c += chunk ){
+		if( TL->cancel != NULL && SDL_AtomicGet( TL->cancel ) ){
+			cancelled = true;
+			break;
+		}
+		int n = min( chunk, row_count - c );
+		face_job FJ = { TL, TT, &hash, HN, rows + c, out };
+		if( TL->pool != NULL ) pool_run_ranges( TL->pool, face_rows, &FJ, n, 1 );
+		else face_rows( &FJ, 0, n );
+
+		for (int r = 0; r < n; ++r ){
+			raw_faces += out[r].raw;
+			ok_vec_foreach_ptr( &(out[r].found), face_candidate *F ){
+				if( wc_set_get( &faces, F->key ) ) continue;
+				wc_set_put( &faces, F->key, 1 );
+
+				regular_poly *P = ok_vec_push_new(&(TL->regpols));
+				P->sides = F->sides;
+				P->center = F->center;
+				P->color = side_palette[ P->sides ];
+				P->angle = F->angle;
+				P->G = tiling_geo( TL, P->sides, P->angle );
+			}
+		}
+		if( TL->progress != NULL && seconds_since( shown ) > 1.0 / 30 ){
+			TL->progress( TL->progress_data, ok_vec_count(&(TL->regpols)) );
+			shown = SDL_GetPerformanceCounter();
+		}
+	}
+	TL->t_faces = seconds_since( t0 );
+
+	for (int r = 0; r < chunk; ++r ) ok_vec_deinit( &(out[r].found) );
+	free( out );
+	free( rows );
+
+	int regpols_N = ok_vec_count(&(TL->regpols));
+	printf("regpols_N: %d (from %d raw face candidates)\n", regpols_N, raw_faces );
+
+	wc_set_deinit(&hash);
+	wc_set_deinit(&faces);
+	if( cancelled ) return -1;
+
+	t0 = SDL_GetPerformanceCounter();
+	tiling_zones( TL );
+	TL->t_zones = seconds_since( t0 );
+	printf("zones: %d x %d, ztotal: %d\n", TL->zones.cols, TL->zones.rows, TL->zones.start[ TL->zones.cols * TL->zones.rows ] );
+	return regpols_N;
+}
+
+void tiling_free( tiling *TL ){
+	ok_vec_foreach_ptr( &(TL->geov), geo *G ){
+		free( G->V );
+		free( G->N );
+	}
+	ok_vec_foreach( &(TL->geo_codes), char *str ){
+		free( str );
+	}
+	ok_vec_deinit(&(TL->regpols));
+	ok_vec_deinit(&(TL->geov));
+	ok_vec_deinit(&(TL->geo_codes));
+	ok_map_deinit(&(TL->geom));
+	zone_grid_free( &(TL->zones) );
+}
+
+
+
+// Maps a whole file read-only, NULL if it can't.
+const void *map_file( const char *filename, size_t *size ){
+#ifdef _WIN32
+	HANDLE f = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL );
+	if( f == INVALID_HANDLE_VALUE ) return NULL;
+	LARGE_INTEGER sz;
+	HANDLE m = ( GetFileSizeEx( f, &sz ) && sz.QuadPart > 0 )? CreateFileMappingA( f, NULL, PAGE_READONLY, 0, 0, NULL ) : NULL;
+	CloseHandle( f );
+	if( m == NULL ) return NULL;
+	const void *p = MapViewOfFile( m, FILE_MAP_READ, 0, 0, 0 );
+	CloseHandle( m );
+	*size = sz.QuadPart;
+	return p;
+#else
+	int fd = open( filename, O_RDONLY );
+	if( fd < 0 ) return NULL;
+	struct stat st;
+	if( fstat( fd, &st ) != 0 || st.st_size == 0 ){
+		close( fd );
+		return NULL;
+	}
+	void *p = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( p == MAP_FAILED ) return NULL;
+	*size = st.st_size;
+	return p;
+#endif
+}
+
+void unmap_file( const void *p, size_t size ){
+#ifdef _WIN32
+	UnmapViewOfFile( p );
+#else
+	munmap( (void*)p, size );
+#endif
+}
+
+
+/*
+	data/tesselations.bin, written by --compile-catalogue from data/tesselations.yaml.
+	All offsets are in bytes from the start of the file.
+
+	header
+	entries   [count]            name/tags offsets, tag bitmask, T1, T2, seed range
+	hash      [hash_size]        entry index + 1 by FNV-1a of the name, 0 = empty
+	seeds     [total seeds][4]   every entry's seed Wcoords, back to back
+	strings                      NUL-terminated names and tags
+
+	It records the size and mtime of the YAML it came from, and is ignored when those
+	no longer match.
+*/
+#define CATALOGUE_BIN  "data/tesselations.bin"
+#define CATALOGUE_YAML "data/tesselations.yaml"
+#define CATALOGUE_VERSION 1
+
+typedef struct {
+	char magic [4]; // "TCAT"
+	Uint32 version;
+	Sint64 yaml_size;
+	Sint64 yaml_mtime;
+	Uint32 file_size;
+	Uint32 count;
+	Uint32 hash_size; // power of two
+	Uint32 entries, hash, seeds, strings;
+} catalogue_header;
+
+typedef struct {
+	Uint32 name, tags;
+	Uint32 tag_mask; // bit c - 'A' for each tag letter
+	Sint32 T1 [4];
+	Sint32 T2 [4];
+	Uint32 seed; // first row in seeds
+	Uint32 seed_count;
+} catalogue_entry;
+
+static Uint32 catalogue_hash( const char *str ){
+	Uint32 h = 2166136261u;
+	for (; *str; ++str ) h = (h ^ (Uint8)(*str)) * 16777619u;
+	return h;
+}
+
+static Uint32 tag_mask( const char *tags ){
+	Uint32 m = 0;
+	for (; tags && *tags; ++tags ){
+		if( *tags >= 'A' && *tags <= 'Z' ) m |= 1u << (*tags - 'A');
+	}
+	return m;
+}
+
+// The tesselations, from the mapped binary when it's there and current, else from YAML.
+// Binary entries are turned into Tess structs only when first asked for.
+typedef struct {
+
+	Tess *yaml;
+	Uint32 yaml_count;
+
+	const Uint8 *bin;
+	size_t bin_size;
+	const catalogue_header *H;
+	const catalogue_entry *E;
+	const Uint32 *hash;
+	const Sint32 *seeds;
+	const char *strings;
+	Tess **made;
+	SDL_mutex *lock;
+
+	int count;
+
+} catalogue;
+
+static bool yaml_stat( Sint64 *size, Sint64 *mtime ){
+	struct stat st;
+	if( stat( CATALOGUE_YAML, &st ) != 0 ) return 0;
+	*size = st.st_size;
+	*mtime = st.st_mtime;
+	return 1;
+}
+
+// Every offset in the mapped file, checked once so lookups never have to: a truncated or
+// damaged file is rejected here instead of being read past its end.
+static bool catalogue_valid( const Uint8 *bin, size_t size ){
+	const catalogue_header *H = (const catalogue_header*) bin;
+	if( H->hash_size == 0 || (H->hash_size & (H->hash_size - 1)) != 0 ) return 0;
+	if( H->entries % 4 || H->hash % 4 || H->seeds % 4 ) return 0;
+	if( H->seeds > H->strings || (H->strings - H->seeds) % (4 * sizeof(Sint32)) != 0 ) return 0;
+	// strings run to the end of the file, each NUL terminated, so a name inside the file ends inside it too
+	if( H->strings >= size || bin[ size - 1 ] != '\0' ) return 0;
+	Uint64 total_seeds = (H->strings - H->seeds) / (4 * sizeof(Sint32));
+	const catalogue_entry *E = (const catalogue_entry*)( bin + H->entries );
+	for (Uint32 i = 0; i < H->count; ++i ){
+		if( (Uint64)H->strings + E[i].name >= size || (Uint64)H->strings + E[i].tags >= size ) return 0;
+		if( (Uint64)E[i].seed + E[i].seed_count > total_seeds ) return 0;
+	}
+	// probing stops at an empty slot, so there has to be one
+	const Uint32 *hash = (const Uint32*)( bin + H->hash );
+	bool empty = 0;
+	for (Uint32 h = 0; h < H->hash_size; ++h ){
+		if( hash[h] > H->count ) return 0;
+		empty |= ( hash[h] == 0 );
+	}
+	return empty;
+}
+
+static bool catalogue_map( catalogue *C ){
+	Sint64 size, mtime;
+	if( !yaml_stat( &size, &mtime ) ) size = mtime = -1; // no YAML to be stale against
+	C->bin = map_file( CATALOGUE_BIN, &(C->bin_size) );
+	if( C->bin == NULL ) return 0;
+	const catalogue_header *H = (const catalogue_header*) C->bin;
+	bool ok = C->bin_size >= sizeof(catalogue_header) && memcmp( H->magic, "TCAT", 4 ) == 0 &&
+	          H->version == CATALOGUE_VERSION && H->file_size == C->bin_size &&
+	          H->entries + (Uint64)H->count * sizeof(catalogue_entry) <= C->bin_size &&
+	          H->hash + (Uint64)H->hash_size * sizeof(Uint32) <= C->bin_size && H->strings < C->bin_size;
+	if( ok && size >= 0 ) ok = ( H->yaml_size == size && H->yaml_mtime == mtime );
+	if( ok ) ok = catalogue_valid( C->bin, C->bin_size );
+	if( !ok ){
+		printf("%s is stale or damaged, reading %s\n", CATALOGUE_BIN, CATALOGUE_YAML );
+		unmap_file( C->bin, C->bin_size );
+		C->bin = NULL;
+		return 0;
+	}
+	C->H = H;
+	C->E = (const catalogue_entry*)( C->bin + H->entries );
+	C->hash = (const Uint32*)( C->bin + H->hash );
+	C->seeds = (const Sint32*)( C->bin + H->seeds );
+	C->strings = (const char*)( C->bin + H->strings );
+	C->count = H->count;
+	C->made = calloc( max( C->count, 1 ), sizeof(Tess*) );
+	C->lock = SDL_CreateMutex();
+	return 1;
+}
+
+bool catalogue_open( catalogue *C ){
+	memset( C, 0, sizeof(catalogue) );
+	if( catalogue_map( C ) ) return 1;
+	cyaml_err_t err = cyaml_load_file( CATALOGUE_YAML, &cyamlconfig, &Tess_seq_schema_value, 
+	                                   (cyaml_data_t **)&(C->yaml), &(C->yaml_count) );
+	if( err != CYAML_OK ){
+		printf("cyaml_load_file error: %s\n", cyaml_strerror(err) );
+		return 0;
+	}
+	C->count = C->yaml_count;
+	return 1;
+}
+
+// Tess view of binary entry i. Seed rows point into the mapping.
+static Tess *catalogue_make( catalogue *C, int i ){
+	SDL_LockMutex( C->lock );
+	if( C->made[i] == NULL ){
+		const catalogue_entry *e = C->E + i;
+		Tess *TT = malloc( sizeof(Tess) );
+		TT->name = (char*)( C->strings + e->name );
+		TT->tags = (char*)( C->strings + e->tags );
+		memcpy( TT->T1, e->T1, sizeof(TT->T1) );
+		memcpy( TT->T2, e->T2, sizeof(TT->T2) );
+		TT->seed_count = e->seed_count;
+		TT->seed = malloc( max( e->seed_count, 1 ) * sizeof(int*) );
+		for (int s = 0; s < e->seed_count; ++s ) TT->seed[s] = (int*)( C->seeds + 4 * (e->seed + s) );
+		C->made[i] = TT;
+	}
+	SDL_UnlockMutex( C->lock );
+	return C->made[i];
+}
+
+// find_tesselation() on either backing. Names are a hash lookup in the binary, and the
+// RANDOM filter only looks at tag bitmasks.
+Tess *catalogue_find( catalogue *C, const char *code, Uint64 *rng ){
+	if( C->bin == NULL ) return find_tesselation( C->yaml, C->yaml_count, code, rng );
+
+	if( strcmp( "RANDOM", code ) == 0 ){
+		const Uint32 wanted = tag_mask( "NCF" ), bad = tag_mask( "B" );
+		int sel_count = 0;
+		for (int i = 0; i < C->count; ++i ){
+			sel_count += ( C->E[i].tag_mask & wanted ) && !( C->E[i].tag_mask & bad );
+		}
+		if( sel_count == 0 ) return NULL;
+		int T = rng? 1 + rng_next( rng ) % sel_count : random(0, sel_count);
+		for (int i = 0; i < C->count; ++i ){
+			if( ( C->E[i].tag_mask & wanted ) && !( C->E[i].tag_mask & bad ) ){
+				if( --T == 0 ) return catalogue_make( C, i );
+			}
+		}
+		return NULL;
+	}
+	Uint32 mask = C->H->hash_size - 1;
+	for (Uint32 h = catalogue_hash( code ) & mask; C->hash[h]; h = (h+1) & mask ){
+		int i = C->hash[h] - 1;
+		if( strcmp( C->strings + C->E[i].name, code ) == 0 ) return catalogue_make( C, i );
+	}
+	return NULL;
+}
+
+// Entry i of either backing, 0 <= i < C->count.
+Tess *catalogue_at( catalogue *C, int i ){
+	return ( C->bin == NULL )? C->yaml + i : catalogue_make( C, i );
+}
+
+// catalogue_find() for CFG->tesselation_code with random(); a "RANDOM" pick's name is
+// written back into the config.
+Tess *select_tesselation( catalogue *C, struct config *CFG ){
+
+	Tess *TT = catalogue_find( C, CFG->tesselation_code, NULL );
+	if( TT != NULL && strcmp( "RANDOM", CFG->tesselation_code ) == 0 ){
+		int nl = strlen( TT->name );
+		if( nl > 6 ){
+			CFG->tesselation_code = realloc( CFG->tesselation_code, nl+1 );
+		}
+		sprintf( CFG->tesselation_code, "%s", TT->name );
+	}
+	return TT;
+}
+
+void catalogue_close( catalogue *C ){
+	if( C->bin != NULL ){
+		for (int i = 0; i < C->count; ++i ){
+			if( C->made[i] ){
+				free( C->made[i]->seed );
+				free( C->made[i] );
+			}
+		}
+		free( C->made );
+		SDL_DestroyMutex( C->lock );
+		unmap_file( C->bin, C->bin_size );
+	}
+	else if( C->yaml != NULL ){
+		cyaml_free( &cyamlconfig, &Tess_seq_schema_value, C->yaml, C->yaml_count );
+	}
+}
+
+
+// Writes CATALOGUE_BIN from CATALOGUE_YAML. Usage: --compile-catalogue
+int compile_catalogue(){
+
+	Uint64 t0 = SDL_GetPerformanceCounter();
+	Tess *tesselations = NULL;
+	Uint32 count = 0;
+	cyaml_err_t err = cyaml_load_file( CATALOGUE_YAML, &cyamlconfig, &Tess_seq_schema_value, 
+	                                   (cyaml_data_t **)&tesselations, &count );
+	if( err != CYAML_OK ){
+		printf("cyaml_load_file error: %s\n", cyaml_strerror(err) );
+		return 1;
+	}
+	double t_yaml = seconds_since( t0 );
+
+	catalogue_header H = { {'T','C','A','T'}, CATALOGUE_VERSION };
+	yaml_stat( &H.yaml_size, &H.yaml_mtime );
+	H.count = count;
+	H.hash_size = 16;
+	while( H.hash_size < 2 * count ) H.hash_size *= 2;
+
+	Uint32 total_seeds = 0, string_bytes = 0;
+	for (int i = 0; i < count; ++i ){
+		total_seeds += tesselations[i].seed_count;
+		string_bytes += strlen( tesselations[i].name ) + 1;
+		string_bytes += (tesselations[i].tags? strlen( tesselations[i].tags ) : 0) + 1;
+	}
+	H.entries = sizeof(catalogue_header);
+	H.hash = H.entries + count * sizeof(catalogue_entry);
+	H.seeds = H.hash + H.hash_size * sizeof(Uint32);
+	H.strings = H.seeds + total_seeds * 4 * sizeof(Sint32);
+	H.file_size = H.strings + string_bytes;
+
+	Uint8 *out = calloc( 1, H.file_size );
+	memcpy( out, &H, sizeof(H) );
+	catalogue_entry *E = (catalogue_entry*)( out + H.entries );
+	Uint32 *hash = (Uint32*)( out + H.hash );
+	Sint32 *seeds = (Sint32*)( out + H.seeds );
+	char *strings = (char*)( out + H.strings );
+	Uint32 seed = 0, str = 0;
+	for (int i = 0; i < count; ++i ){
+		Tess *TT = tesselations + i;
+		E[i].name = str;
+		strcpy( strings + str, TT->name );
+		str += strlen( TT->name ) + 1;
+		E[i].tags = str;
+		strcpy( strings + str, TT->tags? TT->tags : "" );
+		str += (TT->tags? strlen( TT->tags ) : 0) + 1;
+		E[i].tag_mask = tag_mask( TT->tags );
+		memcpy( E[i].T1, TT->T1, sizeof(E[i].T1) );
+		memcpy( E[i].T2, TT->T2, sizeof(E[i].T2) );
+		E[i].seed = seed;
+		E[i].seed_count = TT->seed_count;
+		for (int s = 0; s < TT->seed_count; ++s, ++seed ){
+			memcpy( seeds + 4 * seed, TT->seed[s], 4 * sizeof(Sint32) );
+		}
+		// first entry of a name wins, as in find_tesselation()
+		Uint32 h = catalogue_hash( TT->name ) & (H.hash_size - 1);
+		bool dup = 0;
+		while( hash[h] ){
+			dup |= strcmp( strings + E[ hash[h]-1 ].name, TT->name ) == 0;
+			h = (h+1) & (H.hash_size - 1);
+		}
+		if( !dup ) hash[h] = i + 1;
+	}
+
+	FILE *f = fopen( CATALOGUE_BIN, "wb" );
+	bool ok = f != NULL && fwrite( out, 1, H.file_size, f ) == H.file_size;
+	if( f != NULL ) ok &= ( fclose( f ) == 0 );
+	free( out );
+	cyaml_free( &cyamlconfig, &Tess_seq_schema_value, tesselations, count );
+	if( !ok ){
+		printf("couldn't write %s\n", CATALOGUE_BIN );
+		return 2;
+	}
+
+	// how long a launch now spends on it
+	t0 = SDL_GetPerformanceCounter();
+	catalogue C;
+	catalogue_open( &C );
+	catalogue_close( &C );
+	printf("%s: %u tesselations, %u seed points, %u bytes. YAML load %.2f ms, binary open %.3f ms\n", 
+	        CATALOGUE_BIN, count, total_seeds, H.file_size, t_yaml * 1000, seconds_since( t0 ) * 1000 );
+	return 0;
+}
+
+
+/*
+	Generated polygon sets, cached in <CFG->tiling_cache>/<key hash>.tiling after the
+	first run, and mapped instead of regenerated afterwards. The key is everything
+	regpols depends on: the scale, AAx, the window size and the tesselation's name and
+	a hash of its entry (translations and seeds), so editing other entries of
+	tesselations.yaml doesn't orphan the files of this one. config.yaml only matters
+	through those values. Files are checked on load like any input: anything out of
+	range is a miss, and the file is regenerated.
+
+	header
+	geos      [geo_count]   sides, angle id, radius, apothem, vertex and normal tables
+	polys     [count]       center, sides, angle id, geo index
+*/
+#define TILING_CACHE_VERSION 3
+
+typedef struct {
+	char magic [4]; // "TPOL"
+	Uint32 version;
+	char key [256];
+	Uint32 file_size;
+	Uint32 count, geo_count;
+	float smallest_radius;
+	Uint32 geos, polys;
+} tiling_cache_header;
+
+typedef struct {
+	Sint32 sides, angle;
+	double radius, apothem;
+	vec2d V [12];
+	vec2d N [12];
+} tiling_cache_geo;
+
+typedef struct {
+	vec2d center;
+	Uint8 sides, angle, geo, pad;
+} tiling_cache_poly;
+
+static Uint64 fnv64( Uint64 h, const void *data, size_t len ){
+	for (size_t i = 0; i < len; ++i ) h = (h ^ ((const Uint8*)data)[i]) * 1099511628211ull;
+	return h;
+}
+
+static void tiling_cache_path( tiling *TL, Tess *TT, const char *dir, char *key, char *path ){
+	Uint64 entry = 14695981039346656037ull;
+	entry = fnv64( entry, TT->T1, sizeof(TT->T1) );
+	entry = fnv64( entry, TT->T2, sizeof(TT->T2) );
+	for (int s = 0; s < TT->seed_count; ++s ) entry = fnv64( entry, TT->seed[s], 4 * sizeof(int) );
+	snprintf( key, 256, "%s|%.17g|%d|%d|%d|%016llx", TT->name, TL->scale, TL->AAx, TL->width, TL->height, 
+	          (unsigned long long)entry );
+	Uint64 h = 14695981039346656037ull;
+	for (const char *c = key; *c; ++c ) h = (h ^ (Uint8)(*c)) * 1099511628211ull;
+	snprintf( path, 512, "%s/%016llx.tiling", dir, (unsigned long long)h );
+}
+
+static bool tiling_cache_load( tiling *TL, const char *key, const char *path, SDL_Color **side_palette ){
+
+	size_t size;
+	const Uint8 *bin = map_file( path, &size );
+	if( bin == NULL ) return 0;
+	const tiling_cache_header *H = (const tiling_cache_header*) bin;
+	bool ok = size >= sizeof(tiling_cache_header) && memcmp( H->magic, "TPOL", 4 ) == 0 &&
+	          H->version == TILING_CACHE_VERSION && H->file_size == size &&
+	          strncmp( H->key, key, 256 ) == 0 && H->geo_count <= TILING_MAX_GEOS &&
+	          H->geos + (Uint64)H->geo_count * sizeof(tiling_cache_geo) <= size &&
+	          H->polys + (Uint64)H->count * sizeof(tiling_cache_poly) <= size;
+
+	// everything is checked before TL is touched, so a miss leaves it as it was
+	const tiling_cache_geo *CG = (const tiling_cache_geo*)( bin + H->geos );
+	const tiling_cache_poly *CP = (const tiling_cache_poly*)( bin + H->polys );
+	static const int angle_ids [13] = { 0, 0, 0, 4, 3, 0, 2, 0, 0, 0, 0, 0, 1 };
+	for (int g = 0; ok && g < H->geo_count; ++g ){
+		int n = CG[g].sides;
+		ok = ( n == 3 || n == 4 || n == 6 || n == 12 ) && CG[g].angle >= 0 && CG[g].angle < angle_ids[n];
+		for (int h = 0; ok && h < g; ++h ) ok = ( CG[h].sides != n || CG[h].angle != CG[g].angle );
+	}
+	for (int i = 0; ok && i < H->count; ++i ){
+		ok = CP[i].geo < H->geo_count && CP[i].sides == CG[ CP[i].geo ].sides && CP[i].angle == CG[ CP[i].geo ].angle;
+	}
+	if( !ok ){
+		unmap_file( bin, size );
+		return 0;
+	}
+
+	geo *geos [TILING_MAX_GEOS];
+	for (int g = 0; g < H->geo_count; ++g ){
+		geo *G = tiling_geo( TL, CG[g].sides, CG[g].angle );
+		geos[g] = G;
+		// the tables as they were generated, not recomputed
+		memcpy( G->V, CG[g].V, CG[g].sides * sizeof(vec2d) );
+		memcpy( G->N, CG[g].N, CG[g].sides * sizeof(vec2d) );
+		G->radius = CG[g].radius;
+		G->apothem = CG[g].apothem;
+	}
+	ok_vec_ensure_capacity( &(TL->regpols), H->count );
+	for (int i = 0; i < H->count; ++i ){
+		regular_poly *P = ok_vec_push_new(&(TL->regpols));
+		P->sides = CP[i].sides;
+		P->angle = CP[i].angle;
+		P->center = CP[i].center;
+		P->color = side_palette[ P->sides ];
+		P->G = geos[ CP[i].geo ];
+	}
+	TL->smallest_radius = H->smallest_radius;
+	unmap_file( bin, size );
+	return 1;
+}
+
+static void tiling_cache_save( tiling *TL, const char *key, const char *dir, const char *path ){
+
+	int count = ok_vec_count(&(TL->regpols));
+	int geo_count = ok_vec_count(&(TL->geov));
+	tiling_cache_header H = { {'T','P','O','L'}, TILING_CACHE_VERSION };
+	strncpy( H.key, key, 255 );
+	H.count = count;
+	H.geo_count = geo_count;
+	H.smallest_radius = TL->smallest_radius;
+	H.geos = sizeof(H);
+	H.polys = H.geos + geo_count * sizeof(tiling_cache_geo);
+	H.file_size = H.polys + count * sizeof(tiling_cache_poly);
+
+	Uint8 *out = calloc( 1, H.file_size );
+	memcpy( out, &H, sizeof(H) );
+	tiling_cache_geo *CG = (tiling_cache_geo*)( out + H.geos );
+	for (int g = 0; g < geo_count; ++g ){
+		geo *G = TL->geov.values + g;
+		int sides, angle;
+		sscanf( TL->geo_codes.values[g], "%d:%d", &sides, &angle );
+		CG[g].sides = sides;
+		CG[g].angle = angle;
+		CG[g].radius = G->radius;
+		CG[g].apothem = G->apothem;
+		memcpy( CG[g].V, G->V, sides * sizeof(vec2d) );
+		memcpy( CG[g].N, G->N, sides * sizeof(vec2d) );
+	}
+	tiling_cache_poly *CP = (tiling_cache_poly*)( out + H.polys );
+	for (int i = 0; i < count; ++i ){
+		regular_poly *P = TL->regpols.values + i;
+		CP[i] = (tiling_cache_poly){ P->center, P->sides, P->angle, P->G - TL->geov.values, 0 };
+	}
+
+	// written aside and renamed, so concurrent farm jobs never map a half-written file
+	make_dir( dir );
+	char tmp [540];
+	snprintf( tmp, 540, "%s.%lu.tmp", path, SDL_ThreadID() );
+	FILE *f = fopen( tmp, "wb" );
+	bool ok = f != NULL && fwrite( out, 1, H.file_size, f ) == H.file_size;
+	if( f != NULL ) ok &= ( fclose( f ) == 0 );
+	if( !ok || rename( tmp, path ) != 0 ) remove( tmp );
+	free( out );
+}
+
+// build_tiling() through the cache in `dir` (NULL or "" to bypass it).
+int build_tiling_cached( tiling *TL, Tess *TT, SDL_Color **side_palette, const char *dir ){
+
+	if( dir == NULL || dir[0] == 0 ) return build_tiling( TL, TT, side_palette );
+	char key [256], path [512];
+	tiling_cache_path( TL, TT, dir, key, path );
+	Uint64 t0 = SDL_GetPerformanceCounter();
+	if( tiling_cache_load( TL, key, path, side_palette ) ){
+		TL->t_lattice = 0;
+		TL->t_faces = seconds_since( t0 );
+		printf("TT: %s, %d polygons from %s in %.2f ms\n", TT->name, (int)ok_vec_count(&(TL->regpols)), path, TL->t_faces * 1000 );
+		t0 = SDL_GetPerformanceCounter();
+		tiling_zones( TL );
+		TL->t_zones = seconds_since( t0 );
+		return ok_vec_count(&(TL->regpols));
+	}
+	int N = build_tiling( TL, TT, side_palette );
+	if( N < 0 ) return N;
+	printf("generated in %.2f ms, caching to %s\n", seconds_since( t0 ) * 1000, path );
+	tiling_cache_save( TL, key, dir, path );
+	return N;
+}
+
+
+
+// build_tiling_cached() on a thread of its own, so the window can show the polygons
+// as they are found. The worker owns TL; what it has found so far is copied into
+// `ready` under the lock, and tiling_builder_take() moves it to the render loop's tiling.
+// Prototypes are shared: geov never reallocates and a geo is complete before any
+// polygon pointing at it is published.
+typedef struct {
+
+	tiling TL;
+	Tess *TT;
+	SDL_Color **side_palette;
+	const char *cache_dir;
+
+	thread_pool pool;
+	SDL_Thread *thread;
+	SDL_mutex *lock;
+	SDL_atomic_t cancel;
+	regpolvec ready;
+	int published;
+	int geo_count;
+	float smallest_radius;
+	bool done;
+
+} tiling_builder;
+
+static void tiling_builder_publish( void *data, int count ){
+	tiling_builder *TB = data;
+	SDL_LockMutex( TB->lock );
+	for (int i = TB->published; i < count; ++i ){
+		ok_vec_push( &(TB->ready), TB->TL.regpols.values[i] );
+	}
+	TB->published = count;
+	TB->geo_count = ok_vec_count(&(TB->TL.geov));
+	TB->smallest_radius = TB->TL.smallest_radius;
+	SDL_UnlockMutex( TB->lock );
+}
+
+static int tiling_builder_thread( void *data ){
+	tiling_builder *TB = data;
+	int N = build_tiling_cached( &(TB->TL), TB->TT, TB->side_palette, TB->cache_dir );
+	if( N >= 0 ) tiling_builder_publish( TB, N );
+	SDL_LockMutex( TB->lock );
+	TB->done = 1;
+	SDL_UnlockMutex( TB->lock );
+	return 0;
+}
+
+// TT must outlive the build. Falls back to building right here if there's no thread.
+// `threads` is as for pool_init(); the builder's pool is its own, the render loop's stays free.
+void tiling_builder_start( tiling_builder *TB, int width, int height, double scale, int AAx, 
+                           Tess *TT, SDL_Color **side_palette, const char *cache_dir, int threads ){
+	tiling_init( &(TB->TL), width, height, scale, AAx );
+	pool_init( &(TB->pool), threads );
+	TB->TL.pool = &(TB->pool);
+	TB->TL.progress = tiling_builder_publish;
+	TB->TL.progress_data = TB;
+	SDL_AtomicSet( &(TB->cancel), 0 );
+	TB->TL.cancel = &(TB->cancel);
+	TB->TT = TT;
+	TB->side_palette = side_palette;
+	TB->cache_dir = cache_dir;
+	TB->lock = SDL_CreateMutex();
+	ok_vec_init( &(TB->ready) );
+	TB->published = 0;
+	TB->geo_count = 0;
+	TB->smallest_radius = TB->TL.smallest_radius;
+	TB->done = 0;
+	TB->thread = SDL_CreateThread( tiling_builder_thread, "tiling builder", TB );
+	if( TB->thread == NULL ){
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread error: %s", SDL_GetError() );
+		tiling_builder_thread( TB );
+	}
+}
+
+// Appends whatever was published since the last call to view->regpols. Returns 1 if
+// anything changed (new polygons, or the build finishing), 0 otherwise.
+bool tiling_builder_take( tiling_builder *TB, tiling *view, int *geo_count, bool *done ){
+	SDL_LockMutex( TB->lock );
+	int fresh = ok_vec_count(&(TB->ready));
+	bool changed = fresh > 0 || TB->done != *done;
+	ok_vec_push_all( &(view->regpols), TB->ready.values, fresh );
+	ok_vec_clear( &(TB->ready) );
+	view->smallest_radius = TB->smallest_radius;
+	*geo_count = TB->geo_count;
+	*done = TB->done;
+	SDL_UnlockMutex( TB->lock );
+	return changed;
+}
+
+// Stops the worker at its next chunk and waits for it; the prototypes stay valid until this.
+void tiling_builder_free( tiling_builder *TB ){
+	SDL_AtomicSet( &(TB->cancel), 1 );
+	if( TB->thread != NULL ) SDL_WaitThread( TB->thread, NULL );
+	TB->thread = NULL;
+	pool_deinit( &(TB->pool) );
+	ok_vec_deinit( &(TB->ready) );
+	SDL_DestroyMutex( TB->lock );
+	tiling_free( &(TB->TL) );
+}
+
+// Compares the old sprint_wc() + string ok_map lattice against wc_set, building
+// and probing the dir12 neighbors the same way main() does, on the 3 tesselations
+// with the most seed points per cell. Usage: --bench-wcset [N cells per half-axis]
+int bench_wcset( int N ){
+
+	Uint32 tesselations_count = 0;
+	Tess *tesselations = NULL;
+	cyaml_err_t err = cyaml_load_file( "data/tesselations.yaml", &cyamlconfig, &Tess_seq_schema_value, 
+									   (cyaml_data_t **)&tesselations, &tesselations_count );
+	if( err != CYAML_OK ){
+		printf("cyaml_load_file error: %s\n", cyaml_strerror(err) );
+		return 1;
+	}
+
+	int pick [3] = { -1, -1, -1 };
+	for (int i = 0; i < tesselations_count; ++i ){
+		for (int k = 0; k < 3; ++k ){
+			if( pick[k] < 0 || tesselations[i].seed_count > tesselations[pick[k]].seed_count ){
+				for (int m = 2; m > k; --m ) pick[m] = pick[m-1];
+				pick[k] = i;
+				break;
+			}
+		}
+	}
+
+	char buf [64];
+	printf("bench_wcset: %d x %d translation cells\n", 2*N, 2*N );
+	for (int k = 0; k < 3; ++k ){
+		if( pick[k] < 0 ) break;
+		Tess *TT = tesselations + pick[k];
+
+		// old path: one formatted + malloc'd string per point
+		Uint64 t0 = SDL_GetPerformanceCounter();
+		map_str_int hash;
+		ok_map_init( &hash );
+		str_vec coord_codes;
+		ok_vec_init(&coord_codes);
+		for ( int x = -N; x < N; x++ ) {
+			for ( int y = -N; y < N; y++ ) {
+				Wcoord trans = wc_sum( wc_scaled( TT->T1, x ), wc_scaled( TT->T2, y ) );
+				for (int s = 0; s < TT->seed_count; s++) {
+					sprint_wc( wc_plus_warr( TT->seed[s], trans ), buf );
+					char *str = malloc( strlen(buf)+1 );
+					strcpy( str, buf );
+					ok_vec_push(&coord_codes, str);
+					ok_map_put( &hash, *ok_vec_last(&coord_codes), (s+1) );
+				}
+			}
+		}
+		double str_build = seconds_since( t0 );
+		t0 = SDL_GetPerformanceCounter();
+		int str_hits = 0;
+		for ( int x = -N; x < N; x++ ) {
+			for ( int y = -N; y < N; y++ ) {
+				Wcoord trans = wc_sum( wc_scaled( TT->T1, x ), wc_scaled( TT->T2, y ) );
+				for (int s = 0; s < TT->seed_count; s++) {
+					Wcoord C = wc_plus_warr( TT->seed[s], trans );
+					for ( int d = 0; d < 6; d++ ) {
+						sprint_wc( wc_sum( C, dir12[d] ), buf );
+						if( ok_map_get( &hash, buf ) ) str_hits++;
+					}
+				}
+			}
+		}
+		double str_probe = seconds_since( t0 );
+		ok_map_deinit(&hash);
+		ok_vec_foreach(&coord_codes, char *str){
+			free(str);
+		}
+		ok_vec_deinit(&coord_codes);
+
+		// new path
+		t0 = SDL_GetPerformanceCounter();
+		wc_set S;
+		build_lattice( &S, TT, N, N, NULL );
+		double set_build = seconds_since( t0 );
+		t0 = SDL_GetPerformanceCounter();
+		int set_hits = 0;
+		for ( int x = -N; x < N; x++ ) {
+			for ( int y = -N; y < N; y++ ) {
+				Wcoord trans = wc_sum( wc_scaled( TT->T1, x ), wc_scaled( TT->T2, y ) );
+				for (int s = 0; s < TT->seed_count; s++) {
+					Wcoord C = wc_plus_warr( TT->seed[s], trans );
+					for ( int d = 0; d < 6; d++ ) {
+						if( wc_set_get( &S, wc_sum( C, dir12[d] ) ) ) set_hits++;
+					}
+				}
+			}
+		}
+		double set_probe = seconds_since( t0 );
+		int points = S.count;
+		wc_set_deinit( &S );
+
+		printf("%-20s points:%9d | string map: build %8.2fms probe %8.2fms | wc_set: build %8.2fms probe %8.2fms | x%.1f%s\n",
+				TT->name, points, 1000*str_build, 1000*str_probe, 1000*set_build, 1000*set_probe,
+				(str_build + str_probe) / (set_build + set_probe), (str_hits == set_hits)? "" : "  HIT COUNT MISMATCH!" );
+	}
+
+	cyaml_free( &cyamlconfig, &Tess_seq_schema_value, tesselations, tesselations_count );
+	return 0;
+}
+
+
+// Points per second through the library's scalar open_simplex_noise2d() against the
+// batch path, over N points spread like polygon centers on a 4K AA target.
+// Usage: --bench-noise [N]
+int bench_noise( int N ){
+
+	int seed = 1234;
+	struct osn_context *ctx;
+	open_simplex_noise( seed, &ctx );
+	struct osn_batch_context bctx;
+	open_simplex_noise_batch_init( seed, &bctx );
+
+	float *x = malloc( N * sizeof(float) );
+	float *y = malloc( N * sizeof(float) );
+	float *a = malloc( N * sizeof(float) );
+	float *b = malloc( N * sizeof(float) );
+	for (int i = 0; i < N; ++i ){
+		x[i] = rand() % 7680;
+		y[i] = rand() % 4320;
+	}
+	double nscale = 0.0005, nx = 0.37, ny = -1.21;
+
+	Uint64 t0 = SDL_GetPerformanceCounter();
+	for (int i = 0; i < N; ++i ){
+		a[i] = open_simplex_noise2d( ctx, x[i] * nscale + nx, y[i] * nscale + ny );
+	}
+	double scalar = seconds_since( t0 );
+	t0 = SDL_GetPerformanceCounter();
+	open_simplex_noise2d_batch( &bctx, x, y, N, nscale, nx, ny, b );
+	double batch = seconds_since( t0 );
+
+	double worst = 0;
+	int exact = 0;
+	for (int i = 0; i < N; ++i ){
+		worst = fmax( worst, fabs( a[i] - b[i] ) );
+		exact += ( a[i] == b[i] );
+	}
+	printf("bench_noise: %d points, %s lanes\n", N, bctx.use_avx2? "AVX2" : "scalar" );
+	printf("  scalar: %8.2f Mpts/s\n", N / scalar * 1e-6 );
+	printf("  batch:  %8.2f Mpts/s (x%.2f)\n", N / batch * 1e-6, scalar / batch );
+	printf("  max |diff|: %g, bit-identical: %d / %d\n", worst, exact, N );
+
+	free( x ); free( y ); free( a ); free( b );
+	open_simplex_noise_free( ctx );
+	return 0;
+}
+
+
+// Picks per second on a synthetic hexagon tiling of 10k, 100k and 1M polygons, through
+// the old fixed 16x9 zone layout and through the layout zone_grid_dims() picks.
+// Also times paint_stroke() over 100-pixel strokes on the adaptive layout.
+// Usage: --bench-pick [picks]
+int bench_pick( int picks ){
+
+	double s = 10; // hexagon radius in AA pixels
+	geo hex;
+	geo_init( &hex, 6, M_PI / 6, s );
+	int sizes [] = { 10000, 100000, 1000000 };
+
+	for (int t = 0; t < 3; ++t ){
+		int N = sizes[t];
+		int cols = (int)sqrt( N ), rows = N / cols;
+		double dx = sqrt(3) * s, dy = 1.5 * s;
+		regpolvec regpols;
+		ok_vec_init( &regpols );
+		for (int j = 0; j < rows; ++j ){
+			for (int i = 0; i < cols; ++i ){
+				regular_poly rp = { 6, 0, v2d( s + i * dx + (j & 1) * 0.5 * dx, s + j * dy ), 0, &hex, NULL };
+				ok_vec_push( &regpols, rp );
+			}
+		}
+		N = ok_vec_count( &regpols );
+		SDL_Rect area = { 0, 0, (int)ceil( (cols + 1) * dx + s ), (int)ceil( rows * dy + 2*s ) };
+
+		vec2d *P = malloc( picks * sizeof(vec2d) );
+		for (int k = 0; k < picks; ++k ){
+			P[k] = v2d( (rand() / (double)RAND_MAX) * area.w, (rand() / (double)RAND_MAX) * area.h );
+		}
+
+		int gc, gr;
+		zone_grid_dims( &area, N, s, &gc, &gr );
+		int layouts [2][2] = { { 16, 9 }, { gc, gr } };
+		printf("bench_pick: %d polygons, %d picks\n", N, picks );
+		for (int l = 0; l < 2; ++l ){
+			zone_grid Z;
+			Uint64 t0 = SDL_GetPerformanceCounter();
+			zone_grid_build( &Z, &regpols, &area, layouts[l][0], layouts[l][1], 1 );
+			double build = seconds_since( t0 );
+			int hits = 0;
+			t0 = SDL_GetPerformanceCounter();
+			for (int k = 0; k < picks; ++k ) hits += ( zone_grid_pick( &Z, P[k] ) != NULL );
+			double pick = seconds_since( t0 );
+			printf("  %5d x %-5d build %7.2f ms, %10.0f picks/s, %d hits\n",
+			        layouts[l][0], layouts[l][1], build * 1000, picks / pick, hits );
+			if( l == 1 ){
+				SDL_Color paint [2] = { {255,0,0,255}, {0,0,255,255} };
+				int strokes = picks / 10, painted = 0;
+				t0 = SDL_GetPerformanceCounter();
+				for (int k = 0; k < strokes; ++k ){
+					vec2d b = v2d_sum( P[k], v2d( 100 * cos(k), 100 * sin(k) ) );
+					painted += paint_stroke( paint + (k & 1), P[k], b, &Z, 1 );
+				}
+				double stroke = seconds_since( t0 );
+				printf("  strokes: %10.0f strokes/s, %.1f polygons painted per stroke\n",
+				        strokes / stroke, painted / (double)max( strokes, 1 ) );
+			}
+			zone_grid_free( &Z );
+		}
+		free( P );
+		ok_vec_deinit( &regpols );
+	}
+	free( hex.V );
+	free( hex.N );
+	return 0;
+}
+
+
+// What the windowless modes load up front: the config, its palettes and every tesselation.
+typedef struct {
+	struct config *CFG;
+	palettes PAL;
+	catalogue cat;
+} assets;
+
+bool load_assets( assets *A ){
+	A->CFG = load_config( "config.yaml" );
+	if( A->CFG == NULL ) return 0;
+	if( !load_palettes( &(A->PAL), A->CFG ) ) return 0;
+	return catalogue_open( &(A->cat) );
+}
+
+void free_assets( assets *A ){
+	catalogue_close( &(A->cat) );
+	free( A->PAL.palette );
+	free( A->PAL.solid );
+}
+
+// Builds PS over every polygon of TL (nothing culled) and fills its quad factors from the
+// noise field seeded with noise_seed, on the pool.
+void poster_field( poly_store *PS, tiling *TL, thread_pool *pool, int noise_seed, double nscale, double nx, double ny ){
+	struct osn_context *ctx;
+	open_simplex_noise( noise_seed, &ctx );
+	struct osn_batch_context bctx;
+	open_simplex_noise_batch_init( noise_seed, &bctx );
+	bool osn_batched = ( open_simplex_noise_batch_check( &bctx, ctx, 256, 100 ) <= OSN_BATCH_TOLERANCE );
+	int N = ok_vec_count( &(TL->regpols) );
+	bool *visible = malloc( max( N, 1 ) * sizeof(bool) );
+	memset( visible, 1, max( N, 1 ) * sizeof(bool) );
+	build_poly_store( PS, &(TL->regpols), visible, TL->geov.values, ok_vec_count(&(TL->geov)) );
+	free( visible );
+	field_job FJ = { PS, ctx, &bctx, osn_batched, nscale, nx, ny, NULL };
+	pool_run( pool, field_update_range, &FJ, PS->count, FIELD_ALIGN );
+	open_simplex_noise_free( ctx );
+}
+
+
+// Software rasterizer for the quad faces, so posters can be rendered without a window or
+// renderer. The output is cut into RASTER_TILE x RASTER_TILE tiles which the pool threads
+// take one at a time: each is drawn at `samples` times the resolution into a private buffer
+// (samples = AAx is the supersampling the AAtexture gives on screen), then box-filtered
+// into the surface. samples = 0 draws at output resolution with analytic coverage instead.
+#define RASTER_TILE 64
+
+typedef struct {
+	regpolvec *regpols;
+	float *qf; // by poly_store index
+	zone_grid bins; // one cell per tile, in AA pixels
+	int width, height, AAx;
+	int samples;
+	SDL_Color background;
+	SDL_Surface *out;
+	int first_tile; // jobs count from this tile
+	int out_y;      // canvas row of out's first row
+} raster_job;
+
+// Fills the convex polygon V[0..n), in either winding, into the S x S float RGB tile at
+// (ox, oy). Pixels are sampled at their centers; c is blended by its alpha.
+static void raster_convex( float *rgb, int S, float ox, float oy, vec2d *V, int n, SDL_Color c ){
+
+	double area = 0;
+	double minx = V[0].x, maxx = V[0].x, miny = V[0].y, maxy = V[0].y;
+	for (int i = 0; i < n; ++i ){
+		vec2d P = V[i], Q = V[(i+1)%n];
+		area += P.x * Q.y - Q.x * P.y;
+		minx = fmin( minx, P.x ); maxx = fmax( maxx, P.x );
+		miny = fmin( miny, P.y ); maxy = fmax( maxy, P.y );
+	}
+	if( area == 0 ) return;
+	int x0 = max( 0, (int)floor( minx - ox ) ), x1 = min( S-1, (int)ceil( maxx - ox ) );
+	int y0 = max( 0, (int)floor( miny - oy ) ), y1 = min( S-1, (int)ceil( maxy - oy ) );
+	if( x0 > x1 || y0 > y1 ) return;
+
+	// edge functions A x + B y + C, non-negative inside
+	double sgn = (area > 0)? 1 : -1;
+	double A [12], B [12], C [12];
+	for (int i = 0; i < n; ++i ){
+		vec2d P = V[i], Q = V[(i+1)%n];
+		A[i] = -(Q.y - P.y) * sgn;
+		B[i] =  (Q.x - P.x) * sgn;
+		C[i] = -(A[i] * P.x + B[i] * P.y);
+	}
+
+	float a = c.a / 255.0f, ia = 1 - a;
+	float r = c.r * a, g = c.g * a, b = c.b * a;
+	for (int y = y0; y <= y1; ++y ){
+		double E [12];
+		for (int i = 0; i < n; ++i ) E[i] = A[i] * (ox + x0 + 0.5) + B[i] * (oy + y + 0.5) + C[i];
+		float *d = rgb + 3 * (y * S + x0);
+		for (int x = x0; x <= x1; ++x, d += 3 ){
+			bool in = 1;
+			for (int i = 0; i < n; ++i ){
+				in &= ( E[i] >= 0 );
+				E[i] += A[i];
+			}
+			if( in ){
+				d[0] = r + d[0] * ia;
+				d[1] = g + d[1] * ia;
+				d[2] = b + d[2] * ia;
+			}
+		}
+	}
+}
+
+// Area of the pixel [px, px+1] x [py, py+1] on the inner side of all n edges A x + B y + C >= 0:
+// the pixel square clipped by each edge in turn.
+static float pixel_coverage( double *A, double *B, double *C, int n, double px, double py ){
+	double X [2][16], Y [2][16];
+	int m = 4;
+	X[0][0] = px;   Y[0][0] = py;
+	X[0][1] = px+1; Y[0][1] = py;
+	X[0][2] = px+1; Y[0][2] = py+1;
+	X[0][3] = px;   Y[0][3] = py+1;
+	int cur = 0;
+	for (int i = 0; i < n && m > 0; ++i ){
+		double *x = X[cur], *y = Y[cur], *nx = X[1-cur], *ny = Y[1-cur];
+		int k = 0;
+		for (int j = 0; j < m; ++j ){
+			int jn = (j+1 < m)? j+1 : 0;
+			double e0 = A[i] * x[j]  + B[i] * y[j]  + C[i];
+			double e1 = A[i] * x[jn] + B[i] * y[jn] + C[i];
+			if( e0 >= 0 ){
+				nx[k] = x[j]; ny[k] = y[j]; k++;
+			}
+			if( (e0 >= 0) != (e1 >= 0) ){
+				double t = e0 / (e0 - e1);
+				nx[k] = x[j] + t * (x[jn] - x[j]);
+				ny[k] = y[j] + t * (y[jn] - y[j]);
+				k++;
+			}
+		}
+		m = k;
+		cur = 1-cur;
+	}
+	double area = 0;
+	for (int j = 0; j < m; ++j ){
+		int jn = (j+1 < m)? j+1 : 0;
+		area += X[cur][j] * Y[cur][jn] - X[cur][jn] * Y[cur][j];
+	}
+	return 0.5 * fabs( area );
+}
+
+// raster_convex() with each pixel weighted by how much of it the polygon covers. Pixels
+// whose center is more than half a diagonal from every edge are taken as fully in (or out);
+// only the ones an edge goes through get clipped. Faces aren't composited one over the
+// other, which would let the background through along every shared edge (a quarter of it
+// where two faces split a pixel evenly): acc holds r, g, b and coverage sums per pixel,
+// which raster_tile_range() resolves against the background once all faces are in.
+static void raster_convex_coverage( float *acc, int S, float ox, float oy, vec2d *V, int n, SDL_Color c ){
+
+	double area = 0;
+	double minx = V[0].x, maxx = V[0].x, miny = V[0].y, maxy = V[0].y;
+	for (int i = 0; i < n; ++i ){
+		vec2d P = V[i], Q = V[(i+1)%n];
+		area += P.x * Q.y - Q.x * P.y;
+		minx = fmin( minx, P.x ); maxx = fmax( maxx, P.x );
+		miny = fmin( miny, P.y ); maxy = fmax( maxy, P.y );
+	}
+	if( area == 0 ) return;
+	int x0 = max( 0, (int)floor( minx - ox ) ), x1 = min( S-1, (int)floor( maxx - ox ) );
+	int y0 = max( 0, (int)floor( miny - oy ) ), y1 = min( S-1, (int)floor( maxy - oy ) );
+	if( x0 > x1 || y0 > y1 ) return;
+
+	// edge functions in tile pixels, non-negative inside, and the margin of a half diagonal
+	double sgn = (area > 0)? 1 : -1;
+	double A [12], B [12], C [12], M [12];
+	for (int i = 0; i < n; ++i ){
+		vec2d P = v2d( V[i].x - ox, V[i].y - oy ), Q = v2d( V[(i+1)%n].x - ox, V[(i+1)%n].y - oy );
+		A[i] = -(Q.y - P.y) * sgn;
+		B[i] =  (Q.x - P.x) * sgn;
+		C[i] = -(A[i] * P.x + B[i] * P.y);
+		M[i] = 0.70710678119 * hypot( A[i], B[i] );
+	}
+
+	float a = c.a / 255.0f;
+	float r = c.r, g = c.g, b = c.b;
+	for (int y = y0; y <= y1; ++y ){
+		double E [12];
+		for (int i = 0; i < n; ++i ) E[i] = A[i] * (x0 + 0.5) + B[i] * (y + 0.5) + C[i];
+		float *d = acc + 4 * (y * S + x0);
+		for (int x = x0; x <= x1; ++x, d += 4 ){
+			bool out = 0, in = 1;
+			for (int i = 0; i < n; ++i ){
+				out |= ( E[i] <= -M[i] );
+				in  &= ( E[i] >=  M[i] );
+				E[i] += A[i];
+			}
+			if( out ) continue;
+			float w = a * ( in? 1 : pixel_coverage( A, B, C, n, x, y ) );
+			d[0] += r * w;
+			d[1] += g * w;
+			d[2] += b * w;
+			d[3] += w;
+		}
+	}
+}
+
+void raster_tile_range( void *data, int a, int b ){
+
+	raster_job *RJ = data;
+	bool analytic = ( RJ->samples <= 0 );
+	int k = analytic? 1 : RJ->samples;
+	int S = RASTER_TILE * k;
+	// analytic: r, g, b and coverage sums per pixel
+	int channels = analytic? 4 : 3;
+	float *rgb = malloc( S * S * channels * sizeof(float) );
+	float inv = 1.0f / (k * k);
+	// from the tiling's AA pixels to the buffer's
+	double f = k / (double) RJ->AAx;
+
+	for (int j = a; j < b; ++j ){
+		int t = RJ->first_tile + j;
+		int tx = t % RJ->bins.cols;
+		int ty = t / RJ->bins.cols;
+		float ox = tx * S, oy = ty * S;
+
+		if( analytic ) memset( rgb, 0, S * S * 4 * sizeof(float) );
+		else{
+			for (int i = 0; i < S*S; ++i ){
+				rgb[3*i+0] = RJ->background.r;
+				rgb[3*i+1] = RJ->background.g;
+				rgb[3*i+2] = RJ->background.b;
+			}
+		}
+
+		for (int n = RJ->bins.start[t]; n < RJ->bins.start[t+1]; ++n ){
+			regular_poly *P = RJ->bins.items[n];
+			float quad_factor = RJ->qf[ P->id ];
+			// same faces as gp_quadpoly()
+			if( quad_factor <= 0 || quad_factor >= 1 ) continue;
+			for(int s = 0; s < P->sides; s++){
+				int ns = s+1;
+				if( ns >= P->sides ) ns = 0;
+				int C = (s + P->angle) % P->sides;
+				vec2d V [4] = { v2d( P->center.x +               P->G->V[s ].x, P->center.y +               P->G->V[s ].y ),
+				                v2d( P->center.x +               P->G->V[ns].x, P->center.y +               P->G->V[ns].y ),
+				                v2d( P->center.x + quad_factor * P->G->V[ns].x, P->center.y + quad_factor * P->G->V[ns].y ),
+				                v2d( P->center.x + quad_factor * P->G->V[s ].x, P->center.y + quad_factor * P->G->V[s ].y ) };
+				for (int v = 0; v < 4; ++v ) v2d_mult( V + v, f );
+				if( analytic ) raster_convex_coverage( rgb, S, ox, oy, V, 4, P->color[C] );
+				else           raster_convex( rgb, S, ox, oy, V, 4, P->color[C] );
+			}
+		}
+
+		// box filter down to the output
+		for (int y = 0; y < RASTER_TILE && ty * RASTER_TILE + y < RJ->height; ++y ){
+			Uint32 *row = (Uint32*)( (Uint8*)RJ->out->pixels + (ty * RASTER_TILE + y - RJ->out_y) * RJ->out->pitch );
+			for (int x = 0; x < RASTER_TILE && tx * RASTER_TILE + x < RJ->width; ++x ){
+				float sum [3] = { 0, 0, 0 };
+				if( analytic ){
+					// background shows through what the faces leave uncovered; where rounding
+					// makes them add up to more than the pixel, their mean color
+					float *d = rgb + 4 * (y * S + x);
+					float w = d[3];
+					float scale = (w > 1)? 1 / w : 1;
+					float rest = (w > 1)? 0 : 1 - w;
+					sum[0] = d[0] * scale + RJ->background.r * rest;
+					sum[1] = d[1] * scale + RJ->background.g * rest;
+					sum[2] = d[2] * scale + RJ->background.b * rest;
+				}
+				else for (int sj = 0; sj < k; ++sj ){
+					float *d = rgb + 3 * ((y * k + sj) * S + x * k);
+					for (int si = 0; si < k; ++si, d += 3 ){
+						sum[0] += d[0];
+						sum[1] += d[1];
+						sum[2] += d[2];
+					}
+				}
+				row[ tx * RASTER_TILE + x ] = SDL_MapRGBA( RJ->out->format, lrintf( sum[0] * inv ), lrintf( sum[1] * inv ), 
+				                                                             lrintf( sum[2] * inv ), 255 );
+			}
+		}
+	}
+	free( rgb );
+}
+
+// Rasterizes every polygon of TL with the given quad factors into out, a TL->width x
+// TL->height RGBA32 surface, with `samples` x `samples` supersampling (0: analytic coverage).
+void raster_tiling_into( thread_pool *pool, tiling *TL, float *quad_factors, SDL_Color background, int samples, SDL_Surface *out ){
+
+	raster_job RJ = { &(TL->regpols), quad_factors, { {0} }, TL->width, TL->height, TL->AAx, samples, background, out, 0, 0 };
+	int tiles_x = (TL->width  + RASTER_TILE - 1) / RASTER_TILE;
+	int tiles_y = (TL->height + RASTER_TILE - 1) / RASTER_TILE;
+	int S = RASTER_TILE * TL->AAx;
+	SDL_Rect area = { 0, 0, tiles_x * S, tiles_y * S };
+	zone_grid_build( &RJ.bins, &(TL->regpols), &area, tiles_x, tiles_y, TL->T.s );
+	pool_run( pool, raster_tile_range, &RJ, tiles_x * tiles_y, 1 );
+	zone_grid_free( &RJ.bins );
+}
+
+// raster_tiling_into() a new surface, NULL if it can't be made.
+SDL_Surface *raster_tiling( thread_pool *pool, tiling *TL, float *quad_factors, SDL_Color background, int samples ){
+	SDL_Surface *out = SDL_CreateRGBSurfaceWithFormat( 0, TL->width, TL->height, 32, SDL_PIXELFORMAT_RGBA32 );
+	if( out == NULL ){
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateRGBSurfaceWithFormat error: %s", SDL_GetError() );
+		return NULL;
+	}
+	raster_tiling_into( pool, TL, quad_factors, background, samples, out );
+	return out;
+}
+
+// AA_mode as raster_tiling() samples
+int config_samples( struct config *CFG ){
+	return ( CFG->aa_mode == 1 )? 0 : CFG->AAx;
+}
+
+
+// Renders one poster from config.yaml without opening a window, as the interactive mode
+// would show it on startup. Usage: --headless <width> <height> [seed] [file.png]
+int headless( int argc, char *argv[] ){
+
+	if( argc < 4 ){
+		puts("usage: --headless <width> <height> [seed] [file.png]");
+		return 1;
+	}
+	int width = atoi( argv[2] );
+	int height = atoi( argv[3] );
+	unsigned seed = (argc > 4)? strtoul( argv[4], NULL, 10 ) : time(NULL);
+	char filename [256];
+	if( argc > 5 ) snprintf( filename, 256, "%s", argv[5] );
+	else           snprintf( filename, 256, "poster %u.png", seed );
+	if( width <= 0 || height <= 0 ){
+		puts("headless: width and height must be positive");
+		return 1;
+	}
+
+	if( SDL_Init( 0 ) < 0 ){
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s", SDL_GetError());
+		return 3;
+	}
+	IMG_Init(IMG_INIT_PNG);
+	srand( seed );
+	Uint64 t0 = SDL_GetPerformanceCounter();
+
+	assets A;
+	if( !load_assets( &A ) ) return 3;
+	struct config *CFG = A.CFG;
+	Tess *TT = select_tesselation( &A.cat, CFG );
+	if( TT == NULL ){
+		printf("no tesselation matches \"%s\"\n", CFG->tesselation_code );
+		return 3;
+	}
+	thread_pool pool;
+	pool_init( &pool, CFG->threads );
+
+	tiling TL;
+	tiling_init( &TL, width, height, CFG->scale, CFG->AAx );
+	TL.pool = &pool;
+	int N = build_tiling_cached( &TL, TT, A.PAL.by_sides, CFG->tiling_cache );
+	double t_gen = seconds_since( t0 );
+
+	// same noise field as the first interactive frame
+	t0 = SDL_GetPerformanceCounter();
+	poly_store PS;
+	poster_field( &PS, &TL, &pool, rand(), 0.0005, 0, 0 );
+	double t_field = seconds_since( t0 );
+
+	t0 = SDL_GetPerformanceCounter();
+	SDL_Surface *out = raster_tiling( &pool, &TL, PS.qf, (SDL_Color){0,0,0,255}, config_samples( CFG ) );
+	double t_raster = seconds_since( t0 );
+	int ret = 0;
+	if( out == NULL || IMG_SavePNG( out, filename ) != 0 ){
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "couldn't write \"%s\": %s", filename, SDL_GetError() );
+		ret = 2;
+	}
+	else{
+		printf("wrote \"%s\": %s, %d x %d, seed %u, %d polygons, %d threads\n", 
+		        filename, CFG->tesselation_code, width, height, seed, N, pool.workers + 1 );
+		printf("  generate %.1f ms, field %.1f ms, raster %.1f ms\n", t_gen * 1000, t_field * 1000, t_raster * 1000 );
+	}
+
+	SDL_FreeSurface( out );
+	pool_deinit( &pool );
+	poly_store_free( &PS );
+	tiling_free( &TL );
+	free_assets( &A );
+	IMG_Quit();
+	SDL_Quit();
+	return ret;
+}
+
+
+// Renders a poster of any size straight into a PNG, a band of RASTER_TILE rows at a time:
+// the band's tiles are rasterized on the pool, then its rows are handed to png_stream.
+// Pixel memory is one band plus a tile buffer per thread, whatever the canvas size; the
+// polygons and their zones still scale with it. zoom multiplies the config scale (and
+// divides the noise scale), so the poster looks like a blown up window's worth.
+// Usage: --print <width> <height> [seed] [file.png] [zoom]
+int print_poster( int argc, char *argv[] ){
+
+	if( argc < 4 ){
+		puts("usage: --print <width> <height> [seed] [file.png] [zoom]");
+		return 1;
+	}
+	int width = atoi( argv[2] );
+	int height = atoi( argv[3] );
+	unsigned seed = (argc > 4)? strtoul( argv[4], NULL, 10 ) : time(NULL);
+	char filename [256];
+	if( argc > 5 ) snprintf( filename, 256, "%s", argv[5] );
+	else           snprintf( filename, 256, "print %u.png", seed );
+	double zoom = (argc > 6)? atof( argv[6] ) : 1;
+	if( width <= 0 || height <= 0 || zoom <= 0 ){
+		puts("print: width, height and zoom must be positive");
+		return 1;
+	}
+
+	if( SDL_Init( 0 ) < 0 ){
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s", SDL_GetError());
+		return 3;
+	}
+	srand( seed );
+	Uint64 t0 = SDL_GetPerformanceCounter();
+
+	assets A;
+	if( !load_assets( &A ) ) return 3;
+	struct config *CFG = A.CFG;
+	Tess *TT = select_tesselation( &A.cat, CFG );
+	if( TT == NULL ){
+		printf("no tesselation matches \"%s\"\n", CFG->tesselation_code );
+		return 3;
+	}
+	thread_pool pool;
+	pool_init( &pool, CFG->threads );
+
+	tiling TL;
+	tiling_init( &TL, width, height, CFG->scale * zoom, CFG->AAx );
+	TL.pool = &pool;
+	int N = build_tiling_cached( &TL, TT, A.PAL.by_sides, CFG->tiling_cache );
+	double t_gen = seconds_since( t0 );
+
+	t0 = SDL_GetPerformanceCounter();
+	poly_store PS;
+	poster_field( &PS, &TL, &pool, rand(), 0.0005 / zoom, 0, 0 );
+	double t_field = seconds_since( t0 );
+
+	int tiles_x = (width  + RASTER_TILE - 1) / RASTER_TILE;
+	int tiles_y = (height + RASTER_TILE - 1) / RASTER_TILE;
+	int S = RASTER_TILE * TL.AAx;
+	SDL_Rect area = { 0, 0, tiles_x * S, tiles_y * S };
+	raster_job RJ = { &TL.regpols, PS.qf, { {0} }, width, height, TL.AAx, config_samples( CFG ), (SDL_Color){0,0,0,255}, NULL, 0, 0 };
+	RJ.out = SDL_CreateRGBSurfaceWithFormat( 0, width, RASTER_TILE, 32, SDL_PIXELFORMAT_RGBA32 );
+	Uint8 *rgb = malloc( 3 * (size_t)width );
+	png_stream PNG;
+	int ret = 0;
+	if( RJ.out == NULL || !png_stream_open( &PNG, filename, width, height ) ){
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "couldn't start \"%s\": %s", filename, SDL_GetError() );
+		ret = 2;
+		goto done;
+	}
+	zone_grid_build( &RJ.bins, &TL.regpols, &area, tiles_x, tiles_y, TL.T.s );
+
+	t0 = SDL_GetPerformanceCounter();
+	double t_encode = 0;
+	for (int ty = 0; ty < tiles_y; ++ty ){
+		RJ.first_tile = ty * tiles_x;
+		RJ.out_y = ty * RASTER_TILE;
+		pool_run_ranges( &pool, raster_tile_range, &RJ, tiles_x, 1 );
+
+		Uint64 te = SDL_GetPerformanceCounter();
+		for (int y = 0; y < RASTER_TILE && RJ.out_y + y < height; ++y ){
+			Uint8 *row = (Uint8*)RJ.out->pixels + y * RJ.out->pitch;
+			for (int x = 0; x < width; ++x ){
+				rgb[3*x+0] = row[4*x+0];
+				rgb[3*x+1] = row[4*x+1];
+				rgb[3*x+2] = row[4*x+2];
+			}
+			png_stream_row( &PNG, rgb );
+		}
+		t_encode += seconds_since( te );
+		printf("\rprint: %d / %d rows", min( RJ.out_y + RASTER_TILE, height ), height );
+		fflush( stdout );
+	}
+	double t_total = seconds_since( t0 );
+	zone_grid_free( &RJ.bins );
+	if( !png_stream_close( &PNG ) ){
+		SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "couldn't write \"%s\"", filename );
+		ret = 2;
+	}
+	else{
+		printf("\nwrote \"%s\": %s, %d x %d, seed %u, %d polygons, %d threads\n", 
+		        filename, TT->name, width, height, seed, N, pool.workers + 1 );
+		printf("  generate %.1f ms, field %.1f ms, raster %.1f ms, encode %.1f ms\n", 
+		        t_gen * 1000, t_field * 1000, (t_total - t_encode) * 1000, t_encode * 1000 );
+	}
+
+	done:
+	free( rgb );
+	SDL_FreeSurface( RJ.out );
+	pool_deinit( &pool );
+	poly_store_free( &PS );
+	tiling_free( &TL );
+	free_assets( &A );
+	SDL_Quit();
+	return ret;
+}
+
 
-	SDL_Color tri_palette [3]; 
-	SDL_Color tetra_palette [4];
-	SDL_Color hexa_palette [6];
-	SDL_Color dodec_palette[12];
+// One poster of a print run, as recorded in the manifest.
+typedef struct {
+	Uint64 seed;
+	const char *tesselation;
+	int noise_seed;
+	double nscale, nx, ny;
+	int polygons;
+	bool ok;
+} farm_poster;
 
-	/*for (int i = 0; i < 12; ++i ){
-		if( i < 3  ) tri_palette  [i] = Uint23_to_SDL_Color( pal[i] );
-		if( i < 4  ) tetra_palette[i] = Uint23_to_SDL_Color( pal[i] );
-		if( i < 6  ) hexa_palette [i] = Uint23_to_SDL_Color( pal[i] );
-		if( i < 12 ) dodec_palette[i] = Uint23_to_SDL_Color( pal[i] );
-	}*/
-	
-	for (int i = 0; i < 3; ++i ) tri_palette[i] = lerp_through_array( pal, paln, (1 + (2*i)) / 6.0 );
-	for (int i = 0; i < 4; ++i ) tetra_palette[i] = lerp_through_array( pal, paln, (1 + (2*i)) / 8.0 );
-	for (int i = 0; i < 6; ++i ) hexa_palette[i] = lerp_through_array( pal, paln, (1 + (2*i)) / 12.0 );
-	for (int i = 0; i < 12; ++i ) dodec_palette[i] = lerp_through_array( pal, paln, (1 + (2*i)) / 24.0 );
+typedef struct {
+	assets *A;
+	int width, height;
+	const char *dir;     // SVGs only: gerador_completo.py loads every file in it
+	const char *png_dir;
+	bool svg, png;
+	farm_poster *posters;
+} farm_job;
+
+// Renders posters [a, b). Everything a poster needs is drawn from its own seed, so the
+// result doesn't depend on which thread picks it up or in what order.
+void farm_range( void *data, int a, int b ){
+
+	farm_job *FJ = data;
+	// the jobs already keep every core busy
+	thread_pool serial;
+	pool_init( &serial, 1 );
+	char filename [512];
+
+	for (int i = a; i < b; ++i ){
+		farm_poster *FP = FJ->posters + i;
+		Uint64 rng = FP->seed;
+		FP->ok = 0;
+
+		struct config *CFG = FJ->A->CFG;
+		Tess *TT = catalogue_find( &(FJ->A->cat), CFG->tesselation_code, &rng );
+		if( TT == NULL ) continue;
+		FP->tesselation = TT->name;
+		FP->noise_seed = rng_next( &rng ) & 0x7FFFFFFF;
+		FP->nscale = 0.0005;
+		FP->nx = rng_uniform( &rng, -100, 100 );
+		FP->ny = rng_uniform( &rng, -100, 100 );
+
+		tiling TL;
+		tiling_init( &TL, FJ->width, FJ->height, CFG->scale, CFG->AAx );
+		FP->polygons = build_tiling_cached( &TL, TT, FJ->A->PAL.by_sides, CFG->tiling_cache );
+		poly_store PS;
+		poster_field( &PS, &TL, &serial, FP->noise_seed, FP->nscale, FP->nx, FP->ny );
+
+		FP->ok = 1;
+		if( FJ->svg ){
+			snprintf( filename, 512, "%s/poster %04d.svg", FJ->dir, i );
+			FP->ok &= ( export_svg_config( CFG, &TL.regpols, PS.qf, filename ) == 0 );
+		}
+		if( FJ->png ){
+			snprintf( filename, 512, "%s/poster %04d.png", FJ->png_dir, i );
+			SDL_Surface *out = raster_tiling( &serial, &TL, PS.qf, (SDL_Color){0,0,0,255}, config_samples( CFG ) );
+			FP->ok &= ( out != NULL && IMG_SavePNG( out, filename ) == 0 );
+			SDL_FreeSurface( out );
+		}
 
-	SDL_Color *current_paint = palette + 0;
+		poly_store_free( &PS );
+		tiling_free( &TL );
+	}
+	pool_deinit( &serial );
+}
 
-	//SDL_Color fillA = Uint32_to_SDL_Color( CFG->color_fillA );
-	//SDL_Color fillB = Uint32_to_SDL_Color( CFG->color_fillB );
+// Renders a whole print run, posters in parallel: SVGs into `dir`, which is what
+// gerador_completo.py lays out, so nothing else goes in there. PNGs, when asked for, go
+// to <dir>_png/ and the manifest to <dir>_manifest.csv. Poster i is seeded with first_seed + i.
+// Usage: --farm <count> <width> <height> [first seed] [dir] [svg|png|both]
+int farm( int argc, char *argv[] ){
 
-	//printf("MM: %g\n", CFG->mouse_mass );
+	if( argc < 5 ){
+		puts("usage: --farm <count> <width> <height> [first seed] [dir] [svg|png|both]");
+		return 1;
+	}
+	int count = atoi( argv[2] );
+	int width = atoi( argv[3] );
+	int height = atoi( argv[4] );
+	Uint64 first_seed = (argc > 5)? strtoull( argv[5], NULL, 10 ) : time(NULL);
+	char dir [256];
+	snprintf( dir, 256, "%s", (argc > 6)? argv[6] : "posters" );
+	for (int n = strlen( dir ); n > 1 && ( dir[n-1] == '/' || dir[n-1] == '\\' ); --n ) dir[n-1] = '\0';
+	const char *formats = (argc > 7)? argv[7] : "svg";
+	if( count <= 0 || width <= 0 || height <= 0 ){
+		puts("farm: count, width and height must be positive");
+		return 1;
+	}
 
-	bool panning = 0;
-	bool pressed = 0;
+	if( SDL_Init( 0 ) < 0 ){
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s", SDL_GetError());
+		return 3;
+	}
+	IMG_Init(IMG_INIT_PNG);
+	char png_dir [512];
+	snprintf( png_dir, 512, "%s_png", dir );
+	bool svg = strcmp( formats, "png" ) != 0;
+	bool png = strcmp( formats, "svg" ) != 0;
+	// fine if they're already there
+	if( svg ) make_dir( dir );
+	if( png ) make_dir( png_dir );
+
+	assets A;
+	if( !load_assets( &A ) ) return 3;
+
+	farm_job FJ = { &A, width, height, dir, png_dir, svg, png, NULL };
+	FJ.posters = calloc( count, sizeof(farm_poster) );
+	for (int i = 0; i < count; ++i ){
+		FJ.posters[i].seed = first_seed + i;
+	}
 
-	Transform T = (Transform){ 0, 0, 0, 0, 1, 1 };
-	int scaleI = 0;
-	set_scale( &T, CFG->scale * CFG->AAx );
+	thread_pool pool;
+	pool_init( &pool, A.CFG->threads );
+	Uint64 t0 = SDL_GetPerformanceCounter();
+	pool_run_ranges( &pool, farm_range, &FJ, count, 1 );
+	double elapsed = seconds_since( t0 );
 
-	SDL_Rect bounds = (SDL_Rect){ -T.s, -T.s, 
-							 (CFG->AAx * width)  + 2*(T.s), 
-							 (CFG->AAx * height) + 2*(T.s) };
-	//{ 50, 50, (CFG->AAx * width)-100, (CFG->AAx * height)-100 };
+	char filename [512];
+	snprintf( filename, 512, "%s_manifest.csv", dir );
+	FILE *f = fopen( filename, "w" );
+	int failed = 0;
+	if( f != NULL ) fprintf( f, "index,seed,tesselation,noise_seed,nscale,nx,ny,polygons,ok\n" );
+	for (int i = 0; i < count; ++i ){
+		farm_poster *FP = FJ.posters + i;
+		failed += !FP->ok;
+		if( f != NULL ){
+			fprintf( f, "%d,%llu,%s,%d,%.17g,%.17g,%.17g,%d,%d\n", i, (unsigned long long) FP->seed, 
+			         FP->tesselation? FP->tesselation : "", FP->noise_seed, FP->nscale, FP->nx, FP->ny, FP->polygons, FP->ok );
+		}
+	}
+	if( f != NULL ) fclose( f );
+	else printf("couldn't write \"%s\"\n", filename );
 
-	vec2d T1, T2;
-	int regpols_N = 0;
-	
-	regpolvec regpols;
-	ok_vec_init(&regpols);
+	printf("farm: %d posters (%d failed) in %.1f s on %d threads, %.2f s/poster\n", 
+	        count, failed, elapsed, pool.workers + 1, elapsed / count );
 
-	typedef struct ok_vec_of(geo) geovec;
-	geovec geov;
-	ok_vec_init(&geov);
-	ok_vec_ensure_capacity(&geov, 10);
-	str_vec geo_codes;
-	ok_vec_init(&geo_codes);
-	typedef struct ok_map_of( const char*, geo* ) geomap;
-	geomap geom; 
-	ok_map_init(&geom);
+	pool_deinit( &pool );
+	free( FJ.posters );
+	free_assets( &A );
+	IMG_Quit();
+	SDL_Quit();
+	return (failed > 0)? 2 : 0;
+}
 
 
-	int zone_cols = 16;
-	int zone_rows = 9;
-	
-	zonevec *zones = malloc( zone_rows * zone_cols * sizeof(zonevec) );
-	for (int j = 0; j < zone_rows; ++j ){
-		for (int i = 0; i < zone_cols; ++i ){
-			ok_vec_init( zones + i + (j*zone_cols) );
+// Export time and file size of export_svg_verbose() against export_svg(), per face and
+// merged by color, and export_svg_instanced(), on one windowless poster from config.yaml.
+// The files are removed. Usage: --bench-svg [width height [decimals [levels]]]
+int bench_svg( int argc, char *argv[] ){
+
+	int width = (argc > 3)? atoi( argv[2] ) : 1920;
+	int height = (argc > 3)? atoi( argv[3] ) : 1080;
+	int decimals = (argc > 4)? atoi( argv[4] ) : 2;
+	int levels = (argc > 5)? atoi( argv[5] ) : 64;
+	SDL_Init( 0 );
+	srand( 1234 );
+	assets A;
+	if( !load_assets( &A ) ) return 3;
+	Tess *TT = select_tesselation( &A.cat, A.CFG );
+	if( TT == NULL ) return 3;
+	thread_pool pool;
+	pool_init( &pool, A.CFG->threads );
+	tiling TL;
+	tiling_init( &TL, width, height, A.CFG->scale, A.CFG->AAx );
+	TL.pool = &pool;
+	int N = build_tiling( &TL, TT, A.PAL.by_sides );
+	poly_store PS;
+	poster_field( &PS, &TL, &pool, rand(), 0.0005, 0, 0 );
+
+	printf("bench_svg: %s, %d polygons, %d faces, %d decimals, %d levels\n", TT->name, N, PS.faces, decimals, levels );
+	const char *names [4] = { "fprintf per face", "buffered per face", "buffered merged", "instanced" };
+	char *files [4] = { "bench_svg_0.svg", "bench_svg_1.svg", "bench_svg_2.svg", "bench_svg_3.svg" };
+	double base = 0;
+	for (int m = 0; m < 4; ++m ){
+		Uint64 t0 = SDL_GetPerformanceCounter();
+		if( m == 0 )      export_svg_verbose( &TL.regpols, PS.qf, files[m] );
+		else if( m == 3 ) export_svg_instanced( &TL.regpols, PS.qf, files[m], decimals, levels );
+		else              export_svg( &TL.regpols, PS.qf, files[m], decimals, m == 2 );
+		double t = seconds_since( t0 );
+		if( m == 0 ) base = t;
+		FILE *f = fopen( files[m], "rb" );
+		long size = 0;
+		if( f != NULL ){
+			fseek( f, 0, SEEK_END );
+			size = ftell( f );
+			fclose( f );
 		}
+		printf("  %-18s %8.1f ms (x%5.2f) %8.2f MB\n", names[m], t * 1000, base / t, size / 1048576.0 );
+		remove( files[m] );
 	}
-	//these are inverses. we only ever need to divide by the w/h.
-	float zone_iw = zone_cols / (float)bounds.w;
-	float zone_ih = zone_rows / (float)bounds.h;
 
+	pool_deinit( &pool );
+	poly_store_free( &PS );
+	tiling_free( &TL );
+	free_assets( &A );
+	SDL_Quit();
+	return 0;
+}
 
-	float smallest_radius = 9999999;
+// Quality and cost of the anti-aliasing modes on one windowless poster from config.yaml:
+// raster_tiling() without AA, supersampled at 2, 4 and AA_Level, and with analytic coverage,
+// each against 16 x 16 supersampling. "target" is what the on-screen mode allocates for its
+// AAtexture at that size. Usage: --bench-aa [width height]
+int bench_aa( int argc, char *argv[] ){
+
+	int width = (argc > 3)? atoi( argv[2] ) : 1920;
+	int height = (argc > 3)? atoi( argv[3] ) : 1080;
+	SDL_Init( 0 );
+	srand( 1234 );
+	assets A;
+	if( !load_assets( &A ) ) return 3;
+	Tess *TT = select_tesselation( &A.cat, A.CFG );
+	if( TT == NULL ) return 3;
+	thread_pool pool;
+	pool_init( &pool, A.CFG->threads );
+	tiling TL;
+	tiling_init( &TL, width, height, A.CFG->scale, A.CFG->AAx );
+	TL.pool = &pool;
+	int N = build_tiling( &TL, TT, A.PAL.by_sides );
+	poly_store PS;
+	poster_field( &PS, &TL, &pool, rand(), 0.0005, 0, 0 );
+	SDL_Color black = {0,0,0,255};
+
+	SDL_Surface *ref = raster_tiling( &pool, &TL, PS.qf, black, 16 );
+	if( ref == NULL ) return 3;
+	printf("bench_aa: %s, %d x %d, %d polygons, %d threads\n", TT->name, width, height, N, pool.workers + 1 );
+
+	const int samples [5] = { 1, 2, 4, A.CFG->AAx, 0 };
+	for (int m = 0; m < 5; ++m ){
+		if( m == 3 && ( samples[m] == 1 || samples[m] == 2 || samples[m] == 4 ) ) continue;
+		Uint64 t0 = SDL_GetPerformanceCounter();
+		SDL_Surface *out = raster_tiling( &pool, &TL, PS.qf, black, samples[m] );
+		double t = seconds_since( t0 );
+		if( out == NULL ) break;
+
+		double sum = 0, sq_sum = 0;
+		int worst = 0;
+		for (int y = 0; y < height; ++y ){
+			Uint8 *p = (Uint8*)out->pixels + y * out->pitch;
+			Uint8 *q = (Uint8*)ref->pixels + y * ref->pitch;
+			for (int x = 0; x < 4 * width; ++x ){
+				if( (x & 3) == 3 ) continue;
+				int e = abs( p[x] - q[x] );
+				sum += e;
+				sq_sum += e * e;
+				if( e > worst ) worst = e;
+			}
+		}
+		double count = 3.0 * width * height;
+		double mse = sq_sum / count;
+		int k = max( samples[m], 1 );
+		double target = (double) width * k * height * k * 4 / 1048576.0;
+		char name [32];
+		if( samples[m] > 0 ) snprintf( name, 32, "supersampled %dx%d", k, k );
+		else                 snprintf( name, 32, "analytic" );
+		printf("  %-18s %8.1f ms  target %7.1f MB  mean error %6.3f  max %3d  PSNR %6.2f dB\n", name, t * 1000, 
+		        target, sum / count, worst, (mse > 0)? 10 * log10( 255.0 * 255.0 / mse ) : INFINITY );
+		SDL_FreeSurface( out );
+	}
 
-	const double radii [] = { 0, 0, 0, 0.5773502691, 0.707106781186, 0, 1, 0, 0, 0, 0, 0, 1.93185165257 };
+	SDL_FreeSurface( ref );
+	pool_deinit( &pool );
+	poly_store_free( &PS );
+	tiling_free( &TL );
+	free_assets( &A );
+	SDL_Quit();
+	return 0;
+}
 
-	err = 0;
-	Uint32 tesselations_count = 0;
-	Tess *tesselations = NULL;
-	err |= cyaml_load_file( "data/tesselations.yaml", &cyamlconfig, &Tess_seq_schema_value, &tesselations, &tesselations_count );
-	
-	if( err != CYAML_OK ){
-		printf("cyaml_load_file error: %s\n", cyaml_strerror(err) );
+// Regression harness: every catalogue tesselation at 3 scales and 3 AA_Levels, without a
+// window. Each case is seeded with BENCH_SEED, so the tiling and the noise field are the
+// same from run to run. It times the tiling build phases (lattice, faces, zones) and an SVG
+// export, the best of `reps` runs, and the per-frame field update and quad vertex generation,
+// the best of 10 x reps. The results go to a JSON file with one case per line. If a baseline
+// file from an earlier run is given, each case is compared with it; any phase slower by more
+// than `tolerance` (a fraction) and by more than BENCH_NOISE_MS is reported, and the exit code
+// is then 4. The baseline is read before anything is written, so it can be out.json itself,
+// which then becomes the next baseline. Only tesselations whose name contains `filter` are run.
+// Usage: --bench [out.json [baseline.json [tolerance [filter [reps]]]]]
+#define BENCH_SEED 1234
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_NOISE_MS 0.25
+#define BENCH_METRICS 6
+
+static const char *bench_metric_names [BENCH_METRICS] = { "lattice_ms", "faces_ms", "zones_ms", "field_ms", "vertices_ms", "svg_ms" };
+
+typedef struct {
+	Tess *TT;
+	double scale;
+	int AAx;
+	int polygons, faces;
+	double ms [BENCH_METRICS];
+} bench_case;
+
+static void bench_run_case( assets *A, thread_pool *pool, bench_case *BC, int reps ){
+
+	for (int m = 0; m < BENCH_METRICS; ++m ) BC->ms[m] = INFINITY;
+	tiling TL;
+	for (int r = 0; r < reps; ++r ){
+		if( r > 0 ) tiling_free( &TL );
+		srand( BENCH_SEED );
+		tiling_init( &TL, BENCH_WIDTH, BENCH_HEIGHT, BC->scale, BC->AAx );
+		TL.pool = pool;
+		BC->polygons = build_tiling( &TL, BC->TT, A->PAL.by_sides );
+		BC->ms[0] = fmin( BC->ms[0], 1000 * TL.t_lattice );
+		BC->ms[1] = fmin( BC->ms[1], 1000 * TL.t_faces );
+		BC->ms[2] = fmin( BC->ms[2], 1000 * TL.t_zones );
 	}
-	else{
-		printf("tesselations:%d\n", tesselations_count );
 
-		Tess *TT = NULL;
-		if( strcmp( "RANDOM", CFG->tesselation_code ) == 0 ){
+	int noise_seed = rand();
+	poly_store PS;
+	poster_field( &PS, &TL, pool, noise_seed, 0.0005, 0, 0 );
+	BC->faces = PS.faces;
+	struct osn_context *ctx;
+	open_simplex_noise( noise_seed, &ctx );
+	struct osn_batch_context bctx;
+	open_simplex_noise_batch_init( noise_seed, &bctx );
+	bool osn_batched = ( open_simplex_noise_batch_check( &bctx, ctx, 256, 100 ) <= OSN_BATCH_TOLERANCE );
+	quad_batch QB;
+	build_quad_batch( &QB, &PS );
+
+	for (int r = 0; r < 10 * reps; ++r ){
+		// the field drifts a little every frame, as it does while dragging
+		field_job FJ = { &PS, ctx, &bctx, osn_batched, 0.0005, 0.001 * (r+1), 0, NULL };
+		Uint64 t0 = SDL_GetPerformanceCounter();
+		pool_run( pool, field_update_range, &FJ, PS.visible, FIELD_ALIGN );
+		BC->ms[3] = fmin( BC->ms[3], 1000 * seconds_since( t0 ) );
+
+		quad_batch_job QJ = { &QB, &PS };
+		t0 = SDL_GetPerformanceCounter();
+		pool_run( pool, quad_batch_job_range, &QJ, PS.visible, 1 );
+		BC->ms[4] = fmin( BC->ms[4], 1000 * seconds_since( t0 ) );
+	}
 
-			int sel_count = 0;
-			for (int i = 0; i < tesselations_count; ++i ){
-				if( (strcchr( tesselations[i].tags, 'N' ) || //nice
-					 strcchr( tesselations[i].tags, 'C' ) || //cool
-					 strcchr( tesselations[i].tags, 'F' ))&& //fun
-					 strcchr( tesselations[i].tags, 'B' ) == 0 ){// Bad
+	char filename [] = "bench_tmp.svg";
+	for (int r = 0; r < reps; ++r ){
+		Uint64 t0 = SDL_GetPerformanceCounter();
+		export_svg_config( A->CFG, &TL.regpols, PS.qf, filename );
+		BC->ms[5] = fmin( BC->ms[5], 1000 * seconds_since( t0 ) );
+	}
+	remove( filename );
 
-					sel_count++;
-				}
-			}
-			int T = random(0, sel_count);
-			for (int i = 0; i < tesselations_count; ++i ){
-				if( (strcchr( tesselations[i].tags, 'N' ) || //nice
-					 strcchr( tesselations[i].tags, 'C' ) || //cool
-					 strcchr( tesselations[i].tags, 'F' ))&& //fun
-					 strcchr( tesselations[i].tags, 'B' ) == 0 ){// Bad
-
-					if( --T == 0 ){
-						TT = tesselations + i;
-						break;
-					}
-				}
-			}
-			//TT = tesselations + random(0, tesselations_count);
-			int nl = strlen( TT->name );
-			if( nl > 6 ){
-				CFG->tesselation_code = realloc( CFG->tesselation_code, nl+1 );
+	open_simplex_noise_free( ctx );
+	quad_batch_free( &QB );
+	poly_store_free( &PS );
+	tiling_free( &TL );
+}
+
+// s as the contents of a JSON string
+static void json_escape( char *out, int size, const char *s ){
+	int n = 0;
+	for (; *s != '\0' && n < size - 7; ++s ){
+		if( *s == '"' || *s == '\\' ) out[ n++ ] = '\\';
+		if( (Uint8)*s < 0x20 ) n += sprintf( out + n, "\\u%04x", *s );
+		else out[ n++ ] = *s;
+	}
+	out[n] = '\0';
+}
+
+// The number after "key": in a line of a --bench file, NAN if it isn't there.
+static double bench_value( const char *line, const char *key ){
+	char pat [64];
+	snprintf( pat, 64, "\"%s\":", key );
+	const char *p = strstr( line, pat );
+	return ( p != NULL )? strtod( p + strlen( pat ), NULL ) : NAN;
+}
+
+// The line of a --bench file with the same tesselation, scale and AA_Level, NULL if none.
+static const char *bench_find( char **lines, int line_count, bench_case *BC ){
+	char name [256], pat [300];
+	json_escape( name, 256, BC->TT->name );
+	snprintf( pat, 300, "\"tesselation\":\"%s\",", name );
+	for (int i = 0; i < line_count; ++i ){
+		if( strstr( lines[i], pat ) != NULL && fabs( bench_value( lines[i], "scale" ) - BC->scale ) < 1e-4 &&
+		    lrint( bench_value( lines[i], "AA_Level" ) ) == BC->AAx ){
+			return lines[i];
+		}
+	}
+	return NULL;
+}
+
+// A --bench file split into lines (pointing into *text). Returns the line count, -1 if it can't be read.
+static int bench_load( const char *path, char **text, char ***lines ){
+	FILE *f = fopen( path, "rb" );
+	if( f == NULL ) return -1;
+	fseek( f, 0, SEEK_END );
+	long size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	*text = malloc( size + 1 );
+	size = fread( *text, 1, size, f );
+	(*text)[ size ] = '\0';
+	fclose( f );
+
+	int line_count = 0;
+	*lines = malloc( (size + 1) * sizeof(char*) );
+	for (char *l = strtok( *text, "\r\n" ); l != NULL; l = strtok( NULL, "\r\n" ) ) (*lines)[ line_count++ ] = l;
+	return line_count;
+}
+
+// Reports the phases slower than the baseline's lines. Returns how many there are.
+static int bench_compare( bench_case *cases, int count, char **lines, int line_count, const char *path, double tolerance ){
+	int matched = 0, slower = 0, faster = 0;
+	for (int c = 0; c < count; ++c ){
+		bench_case *BC = cases + c;
+		const char *line = bench_find( lines, line_count, BC );
+		if( line == NULL ) continue;
+		matched++;
+		for (int m = 0; m < BENCH_METRICS; ++m ){
+			double base = bench_value( line, bench_metric_names[m] );
+			if( isnan( base ) ) continue;
+			double now = BC->ms[m];
+			if( now > base * (1 + tolerance) && now - base > BENCH_NOISE_MS ){
+				printf("  SLOWER  %-24s scale %5g AA %d  %-12s %9.3f -> %9.3f ms (%+.0f%%)\n", BC->TT->name, BC->scale, BC->AAx,
+				        bench_metric_names[m], base, now, 100 * (now / base - 1) );
+				slower++;
 			}
-			sprintf( CFG->tesselation_code, "%s", TT->name );
+			else if( now < base * (1 - tolerance) && base - now > BENCH_NOISE_MS ) faster++;
 		}
-		else{
-			for (int i = 0; i < tesselations_count; ++i ){
-				if( strcmp( tesselations[i].name, CFG->tesselation_code ) == 0 ){
-					TT = tesselations + i;
-					printf("grabbing tesselations[%d]\n", i );
-					break;
-				}
+	}
+	printf("baseline \"%s\": %d of %d cases matched, %d phases slower, %d faster (tolerance %.0f%%)\n",
+	        path, matched, count, slower, faster, 100 * tolerance );
+	return slower;
+}
+
+int bench( int argc, char *argv[] ){
+
+	const char *out_path = (argc > 2)? argv[2] : "bench.json";
+	const char *baseline = (argc > 3)? argv[3] : NULL;
+	double tolerance = (argc > 4)? atof( argv[4] ) : 0.1;
+	const char *filter = (argc > 5)? argv[5] : "";
+	int reps = (argc > 6)? max( 1, atoi( argv[6] ) ) : 3;
+
+	// read up front: out_path may well be the baseline, and it's about to be overwritten
+	char *base_text = NULL, **base_lines = NULL;
+	int base_count = 0;
+	if( baseline != NULL ){
+		base_count = bench_load( baseline, &base_text, &base_lines );
+		if( base_count < 0 ){
+			printf("couldn't read baseline \"%s\"\n", baseline );
+			return 2;
+		}
+	}
+
+	SDL_Init( 0 );
+	assets A;
+	if( !load_assets( &A ) ) return 3;
+	thread_pool pool;
+	pool_init( &pool, A.CFG->threads );
+
+	const double scales [3] = { 0.5 * A.CFG->scale, A.CFG->scale, 2 * A.CFG->scale };
+	const int AAs [3] = { 1, 2, 4 };
+	bench_case *cases = malloc( max( A.cat.count, 1 ) * 9 * sizeof(bench_case) );
+	int count = 0;
+	for (int i = 0; i < A.cat.count; ++i ){
+		Tess *TT = catalogue_at( &A.cat, i );
+		if( strstr( TT->name, filter ) == NULL ) continue;
+		for (int s = 0; s < 3; ++s ){
+			for (int a = 0; a < 3; ++a ){
+				bench_case *BC = cases + count++;
+				BC->TT = TT;
+				BC->scale = scales[s];
+				BC->AAx = AAs[a];
 			}
 		}
+	}
+	printf("bench: %d cases, %d x %d, %d threads, best of %d\n", count, BENCH_WIDTH, BENCH_HEIGHT, pool.workers + 1, reps );
+
+	Uint64 t0 = SDL_GetPerformanceCounter();
+	for (int c = 0; c < count; ++c ){
+		bench_case *BC = cases + c;
+		bench_run_case( &A, &pool, BC, reps );
+		printf("[%d/%d] %s scale %g AA %d: %d polygons, lattice %.2f faces %.2f zones %.2f field %.3f vertices %.3f svg %.2f ms\n",
+		        c+1, count, BC->TT->name, BC->scale, BC->AAx, BC->polygons,
+		        BC->ms[0], BC->ms[1], BC->ms[2], BC->ms[3], BC->ms[4], BC->ms[5] );
+	}
+	double elapsed = seconds_since( t0 );
+
+	FILE *f = fopen( out_path, "w" );
+	if( f == NULL ){
+		printf("couldn't write \"%s\"\n", out_path );
+		return 2;
+	}
+	fprintf( f, "{\"version\":1,\"width\":%d,\"height\":%d,\"threads\":%d,\"seed\":%d,\"reps\":%d,\"cases\":[\n",
+	         BENCH_WIDTH, BENCH_HEIGHT, pool.workers + 1, BENCH_SEED, reps );
+	for (int c = 0; c < count; ++c ){
+		bench_case *BC = cases + c;
+		char name [256];
+		json_escape( name, 256, BC->TT->name );
+		fprintf( f, "{\"tesselation\":\"%s\",\"scale\":%.6g,\"AA_Level\":%d,\"polygons\":%d,\"faces\":%d", 
+		         name, BC->scale, BC->AAx, BC->polygons, BC->faces );
+		for (int m = 0; m < BENCH_METRICS; ++m ) fprintf( f, ",\"%s\":%.4f", bench_metric_names[m], BC->ms[m] );
+		fprintf( f, "}%s\n", (c < count - 1)? "," : "" );
+	}
+	fprintf( f, "]}\n" );
+	fclose( f );
+	printf("bench: wrote \"%s\" in %.1f s\n", out_path, elapsed );
 
-		printf("TT: %s, seed_count: %d\n", TT->name, TT->seed_count );
+	int ret = 0;
+	if( baseline != NULL && bench_compare( cases, count, base_lines, base_count, baseline, tolerance ) > 0 ) ret = 4;
+	free( base_lines );
+	free( base_text );
 
-		Wcoord dir12 [12];
-		dir12[0] = wc(1, 0, 0, 0);
-		dir12[1] = wc(0, 1, 0, 0);
-		dir12[2] = wc(0, 0, 1, 0);
-		dir12[3] = wc(0, 0, 0, 1);
-		dir12[4] = wc(-1, 0, 1, 0);
-		dir12[5] = wc(0, -1, 0, 1);
-		dir12[6] = wc(-1, 0, 0, 0);
-		dir12[7] = wc(0, -1, 0, 0);
-		dir12[8] = wc(0, 0, -1, 0);
-		dir12[9] = wc(0, 0, 0, -1);
-		dir12[10] = wc(1, 0, -1, 0);
-		dir12[11] = wc(0, 1, 0, -1);
+	free( cases );
+	pool_deinit( &pool );
+	free_assets( &A );
+	SDL_Quit();
+	return ret;
+}
 
-		//                                2  3  4   5   
-		const int polytype [] = { -1, -1, 3, 4, 6, 12 };
 
-		map_str_int hash;
-		ok_map_init( &hash );
-		str_vec coord_codes;
-		ok_vec_init(&coord_codes);
+int main(int argc, char *argv[]){
 
-		vec2d bbmin = v2d( 999999,  999999);
-		vec2d bbmax = v2d(-999999, -999999);
-		for (int s = 0; s < TT->seed_count; s++) {
-			vec2d v = warr_to_v2d( TT->seed[s] );
-			if( v.x < bbmin.x ) bbmin.x = v.x;
-			if( v.y < bbmin.y ) bbmin.y = v.y;
-			if( v.x > bbmax.x ) bbmax.x = v.x;
-			if( v.y > bbmax.y ) bbmax.y = v.y;
-		}
-		vec2d bb = v2d_diff( bbmax, bbmin );
-		int WN = ceil( 6 * (width  / (bb.x * CFG->scale)) );
-		int HN = ceil( 6 * (height / (bb.y * CFG->scale)) );
-		//printf(">%d, %d\n", WN, HN );
-
-		vec2d vT1 = warr_to_v2d( TT->T1 );
-		vec2d vT2 = warr_to_v2d( TT->T2 );
-		vec2d vtt = v2d_sum( vT1, vT2 );
-		int tWN = ceil( 6 * (width  / (vtt.x * CFG->scale)) );
-		int tHN = ceil( 6 * (height / (vtt.y * CFG->scale)) );
-		//printf(">%d, %d\n", tWN, tHN );
-
-		WN = max( WN, tWN );
-		HN = max( HN, tHN );
-		printf("WN:%d, HN:%d\n", WN, HN );
-		if( WN < 24 ) WN = HN;
-		if( HN < 24 ) HN = WN;
-		if( WN < 24 ) WN = 24;
-		if( HN < 24 ) HN = 24;
-		printf("WN:%d, HN:%d\n", WN, HN );
-
-		for ( int x = -WN; x < WN; x++ ) {
-			for ( int y = -HN; y < HN; y++ ) {
-				Wcoord trans = wc_sum( wc_scaled( TT->T1, x ), wc_scaled( TT->T2, y ) );
-				for (int s = 0; s < TT->seed_count; s++) {
-					Wcoord C = wc_plus_warr( TT->seed[s], trans );
-					sprint_wc( C, buf );
-					char *str = malloc( strlen(buf)+1 );
-					strcpy( str, buf );
-					ok_vec_push(&coord_codes, str);
-					ok_map_put( &hash, *ok_vec_last(&coord_codes), (s+1) );
-				}
-			}
+	if( argc > 1 && strcmp( argv[1], "--bench-wcset" ) == 0 ){
+		return bench_wcset( (argc > 2)? atoi( argv[2] ) : 64 );
+	}
+	if( argc > 1 && strcmp( argv[1], "--bench-noise" ) == 0 ){
+		return bench_noise( (argc > 2)? atoi( argv[2] ) : 1000000 );
+	}
+	if( argc > 1 && strcmp( argv[1], "--bench-pick" ) == 0 ){
+		return bench_pick( (argc > 2)? atoi( argv[2] ) : 10000 );
+	}
+	if( argc > 1 && strcmp( argv[1], "--bench-svg" ) == 0 ){
+		return bench_svg( argc, argv );
+	}
+	if( argc > 1 && strcmp( argv[1], "--bench-aa" ) == 0 ){
+		return bench_aa( argc, argv );
+	}
+	if( argc > 1 && strcmp( argv[1], "--bench" ) == 0 ){
+		return bench( argc, argv );
+	}
+	if( argc > 1 && strcmp( argv[1], "--compile-catalogue" ) == 0 ){
+		return compile_catalogue();
+	}
+	if( argc > 1 && strcmp( argv[1], "--headless" ) == 0 ){
+		return headless( argc, argv );
+	}
+	if( argc > 1 && strcmp( argv[1], "--print" ) == 0 ){
+		return print_poster( argc, argv );
+	}
+	if( argc > 1 && strcmp( argv[1], "--farm" ) == 0 ){
+		return farm( argc, argv );
+	}
+
+	srand (time(NULL));
+	char buf [256];
+	Uint64 t_start = SDL_GetPerformanceCounter();
+
+	// --capture <frames> [fps] [file | -] [y4m | raw] [drift]: records `frames` frames of the
+	// noise field drifting `drift` noise units a second along x, one 1/fps step per frame
+	// however long it takes to draw, then quits. "-" streams to stdout.
+	int capture_left = 0;
+	int capture_fps = 30;
+	const char *capture_path = "capture.y4m";
+	bool capture_y4m = 1;
+	double capture_drift = 0.05;
+	if( argc > 1 && strcmp( argv[1], "--capture" ) == 0 ){
+		if( argc < 3 || atoi( argv[2] ) <= 0 ){
+			puts("usage: --capture <frames> [fps] [file | -] [y4m | raw] [drift]");
+			return 1;
 		}
-		printf("ok_vec_count(&coord_codes): %d\n", ok_vec_count(&coord_codes) );
+		capture_left = atoi( argv[2] );
+		if( argc > 3 ) capture_fps = max( 1, atoi( argv[3] ) );
+		if( argc > 4 ) capture_path = argv[4];
+		if( argc > 5 ) capture_y4m = ( strcmp( argv[5], "raw" ) != 0 );
+		if( argc > 6 ) capture_drift = atof( argv[6] );
+	}
+	frame_stream FS = {0};
+	int captured = 0;
+	Uint64 capture_t0 = 0;
 
-		for ( int x = -WN; x < WN; x++ ) {
-			for ( int y = -HN; y < HN; y++ ) {
-				//printf("\n%dx%d\n", x, y );
-				Wcoord trans = wc_sum( wc_scaled( TT->T1, x ), wc_scaled( TT->T2, y ) );
-				for (int s = 0; s < TT->seed_count; s++) {
-					Wcoord C = wc_plus_warr( TT->seed[s], trans );
-					int face = 0;
-					int neighs [12];
-					for ( int d = 0; d < 6; d++ ) {
-						Wcoord neighbor = wc_sum( C, dir12[d] );
-						sprint_wc( neighbor, buf );
-						if( ok_map_get( &hash, buf ) ){
-							//putchar('>');
-							neighs[ face++ ] = d;
-						}
-					}
+	//HWND hwnd_win = GetConsoleWindow();
+	//ShowWindow(hwnd_win,SW_HIDE);
+	SDL_Window *window;
+	SDL_Renderer *rend;
+	int width, height;
+	bool loop = 1;
+	vec2d mouse = v2dzero;
+	vec2d pmouse = v2dzero;
 
-					for( int n = 0; n < face-1; n++ ){
 
-						int diff = neighs[n+1] - neighs[n];
-						int skip = 12 / polytype[diff];
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s", SDL_GetError());
+		return 3;
+	}
 
-						vec2d centroid = v2d(0,0);
-						vec2d first = v2d(NAN,0);
-						
-						Wcoord fc = C;
-						for ( int f = 0; f < 12; f += skip ) {
-							Wcoord nfc = wc_sum( fc, dir12[ (neighs[n] + f) % 12 ] );
-							vec2d F = wc_to_v2d( nfc );
-							if( isnan(first.x) ){
-								first = F;
-							}
-							v2d_add( &(centroid), F );
-							fc = nfc;
-						}
-						v2d_mult( &(centroid), 1.0 / polytype[diff] );
-						vec2d tcen = apply_transform_v2d( &(centroid), &T );
-
-						if( coordinates_in_Rect( tcen.x, tcen.y, &bounds ) ){
-							regular_poly *P = ok_vec_push_new(&regpols);
-							P->sides = polytype[diff];
-							P->center = tcen;
-							//P->color = palette + 6;
-
-							switch( P->sides ){
-								case 3:
-									P->color = tri_palette;
-									break;
-								case 4:
-									P->color = tetra_palette;
-									break;
-								case 6:
-									P->color = hexa_palette;
-									break;
-								case 12:
-									P->color = dodec_palette;
-									break;
-								default:
-									P->color = palette;
-							}
+	if (SDL_CreateWindowAndRenderer(1, 1, SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED, &window, &rend)) {
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create window and renderer: %s", SDL_GetError());
+		return 3;
+	}
+	SDL_SetRenderDrawBlendMode( rend, SDL_BLENDMODE_BLEND );
+	//SDL_MaximizeWindow( window );
+	SDL_SetWindowTitle( window, "Tecniquim 00" );
+	SDL_GetWindowSize( window, &width, &height );
+	int cx = width/2;
+	int cy = height/2;
 
-							//printf("~ %d, %.12lg\n", P->sides, angle );
-							double angle = v2d_heading( v2d_diff(first, centroid) );
-							int angle_id = breakdown_regpol_angle( P->sides, angle );
-							P->angle = angle_id;
-
-							sprintf( buf, "%d:%d", P->sides, angle_id );
-							geo* G = ok_map_get(&geom, buf);
-							if( G == NULL ){
-								//printf("neogeo: [%s]\n", buf );
-								G = ok_vec_push_new(&geov);
-								G->V = malloc( P->sides * sizeof(vec2d) );
-								angle = angle_from_id( P->sides, angle_id );
-								float radius = T.s * radii[ P->sides ];
-								if( radius < smallest_radius ) smallest_radius = radius;
-								for (int v = 0; v < P->sides; ++v ){
-									double theta = angle + v * two_pi_over[ P->sides ];
-									G->V[v] = v2d( radius*cos(theta), radius*sin(theta) );
-								}
-								char *str = malloc( strlen(buf)+1 );
-								strcpy( str, buf );
-								ok_vec_push(&geo_codes, str);
-								ok_map_put( &geom, *ok_vec_last(&geo_codes), G );
-							}
-							P->G = G;
-						}
-					}
-				}
-			}
-		}
+	IMG_Init(IMG_INIT_PNG);
+	//SDL_Surface *icon = IMG_Load( "icon32.png" );
+	//SDL_SetWindowIcon( window, icon );
 
-		cyaml_free( &cyamlconfig, &Tess_seq_schema_value, tesselations, tesselations_count );
+	
 
-		regpols_N = ok_vec_count(&regpols);
-		printf("regpols_N: %d\n", regpols_N );
 
-		ok_map_deinit(&hash);
-		ok_vec_foreach(&coord_codes, char *str){
-			free(str);
-		}
-		ok_vec_deinit(&coord_codes);
+	Uint64 t0 = SDL_GetPerformanceCounter();
+	struct config *CFG = load_config( "config.yaml" );
+	if( CFG == NULL ) abort();
+	double t_config = seconds_since( t0 );
 
+	
+	SDL_Color edge_color = Uint32_to_SDL_Color( CFG->edge_color );
+	CFG->edge_thickness = CFG->edge_thickness * CFG->AAx * 0.5;
 
-		ok_vec_foreach_ptr(&regpols, regular_poly *P) {
-			//Registering polygons into zones:
-			int I = (int)((P->center.x - bounds.x) * zone_iw);
-			int J = (int)((P->center.y - bounds.y) * zone_ih);
-			float radius = T.s * radii[ P->sides ];
-			//printf("%d = (%lg - %d) * %g\n", I, tcen.x, bounds.x, zone_iw );
-			ok_vec_push(zones + I + (J*zone_cols), P);
-			//fuzzying the zoning:
-			// right
-			int Ip = (int)((P->center.x + radius - bounds.x) * zone_iw);
-			bool doIp = (Ip != I) && Ip < zone_cols;
-			if( doIp ) ok_vec_push(zones + Ip + (J*zone_cols), P);
-			// left
-			int Im = (int)((P->center.x - radius - bounds.x) * zone_iw);
-			bool doIm = (Im != I) && Im >= 0;
-			if( doIm ) ok_vec_push(zones + Im + (J*zone_cols), P);
-			// below
-			int Jp = (int)((P->center.y + radius - bounds.y) * zone_ih);
-			bool doJp = (Jp != J) && Jp < zone_rows;
-			if( doJp ) ok_vec_push(zones + I + (Jp * zone_cols), P);
-			// above
-			int Jm = (int)((P->center.y - radius - bounds.y) * zone_ih);
-			bool doJm = (Jm != J) && Jm >= 0;
-			if( doJm ) ok_vec_push(zones + I + (Jm * zone_cols), P);
-			// pp
-			if( doIp && doJp ) ok_vec_push(zones + Ip + (Jp * zone_cols), P);
-			// pm
-			if( doIp && doJm ) ok_vec_push(zones + Ip + (Jm * zone_cols), P);
-			// mp
-			if( doIm && doJp ) ok_vec_push(zones + Im + (Jp * zone_cols), P);
-			// mm
-			if( doIm && doJm ) ok_vec_push(zones + Im + (Jm * zone_cols), P);
-		}
-
-		int ztotal = 0;
-		for (int j = 0; j < zone_rows; ++j ){
-			for (int i = 0; i < zone_cols; ++i ){
-				int Z = ok_vec_count( zones + i + (j*zone_cols) );
-				//printf("%02d, ", Z );
-				ztotal += Z;
-			}
-			//puts("");
-		}
-		printf("ztotal: %d\n", ztotal );
-	}
+	palettes PAL;
+	if( !load_palettes( &PAL, CFG ) ) return 3;
+	SDL_Color *palette = PAL.palette;
+	int palW = 30;
+	int palY = (height - (CFG->palette_count * palW))/2;
+
+	SDL_Color Z = {0,0,0,0};
 
+	SDL_Color *current_paint = PAL.solid[0];
 
-	float halo_radius = smallest_radius * CFG->halo_radius;
-	vec2d *halo_offsets = NULL;
-	if( CFG->halo_points > 0 ){	
-		halo_offsets = malloc( CFG->halo_points * sizeof(vec2d) );
-		float halo_alpha = TWO_PI / CFG->halo_points;
-		for (int i = 0; i < CFG->halo_points; ++i ){
-			halo_offsets[i] = v2d( halo_radius * cos(i * halo_alpha), halo_radius * sin(i * halo_alpha) );
+	//SDL_Color fillA = Uint32_to_SDL_Color( CFG->color_fillA );
+	//SDL_Color fillB = Uint32_to_SDL_Color( CFG->color_fillB );
+
+	//printf("MM: %g\n", CFG->mouse_mass );
+
+	bool panning = 0;
+	bool pressed = 0;
+
+	int scaleI = 0;
+	tiling TL;
+	tiling_init( &TL, width, height, CFG->scale, CFG->AAx );
+	tiling_zones( &TL );
+
+	vec2d T1, T2;
+
+	// TL is what's on screen; the builder fills it in from its own thread, center first.
+	tiling_builder TB;
+	bool started = 0;
+	bool building = 0;
+	bool built = 0;
+	int geo_count = 0;
+	bool shown_first = 0;
+	double t_catalogue = 0;
+
+	catalogue cat;
+	t0 = SDL_GetPerformanceCounter();
+	bool cat_open = catalogue_open( &cat );
+	if( cat_open ){
+		t_catalogue = seconds_since( t0 );
+		printf("tesselations:%d%s\n", cat.count, cat.bin? " (binary)" : "" );
+
+		Tess *TT = select_tesselation( &cat, CFG );
+		if( TT == NULL ){
+			printf("no tesselation matches \"%s\"\n", CFG->tesselation_code );
+		}
+		else{
+			tiling_builder_start( &TB, width, height, CFG->scale, CFG->AAx, TT, PAL.by_sides, CFG->tiling_cache, CFG->threads );
+			started = 1;
+			building = 1;
 		}
 	}
 
+	vec2d *halo_offsets = NULL;
+
 
 	struct osn_context *ctx;
-	open_simplex_noise( rand(), &ctx );
+	int noise_seed = rand();
+	open_simplex_noise( noise_seed, &ctx );
+	// the batch path keeps its own copy of the permutation; only trust it if it agrees with the library.
+	struct osn_batch_context bctx;
+	open_simplex_noise_batch_init( noise_seed, &bctx );
+	double osn_err = open_simplex_noise_batch_check( &bctx, ctx, 4096, 100 );
+	bool osn_batched = ( osn_err <= OSN_BATCH_TOLERANCE );
+	if( !osn_batched ){
+		printf("batch noise disagrees with open_simplex_noise2d() by %g, using the scalar path.\n", osn_err );
+	}
 	double nscale = 0.0005;
 	double nx = 0;
 	double ny = 0;
 	//puts("created noise context");//debug
 
-	vec2d bcenter = v2d( lerp( bounds.x, bounds.x+bounds.w, 0.5), lerp( bounds.y, bounds.y+bounds.h, 0.5) );
-	double max_dist = hypot( bcenter.x - bounds.x, bcenter.y - bounds.y );
+	vec2d bcenter = v2d( lerp( TL.bounds.x, TL.bounds.x+TL.bounds.w, 0.5), lerp( TL.bounds.y, TL.bounds.y+TL.bounds.h, 0.5) );
+	double max_dist = hypot( bcenter.x - TL.bounds.x, bcenter.y - TL.bounds.y );
+
+	SDL_Rect view = (SDL_Rect){ 0, 0, CFG->AAx * width, CFG->AAx * height };
+	// empty until the builder publishes something
+	poly_store PS;
+	build_poly_store( &PS, &TL.regpols, NULL, NULL, 0 );
 
-	ok_vec_foreach_ptr(&regpols, regular_poly *rp){
+	for (int i = 0; i < PS.count; ++i ){
 		
 		//noise	
-		rp->quad_factor = open_simplex_noise2d( ctx, rp->center.x * nscale + nx, rp->center.y * nscale + ny );
-		rp->quad_factor = constrainF( rp->quad_factor + 0.5, 0, 1 );
+		PS.qf[i] = open_simplex_noise2d( ctx, PS.cx[i] * nscale + nx, PS.cy[i] * nscale + ny );
+		PS.qf[i] = constrainF( PS.qf[i] + 0.5, 0, 1 );
 
 		// linear
-		//rp->quad_factor = constrainF( map( rp->center.x, bounds.x, bounds.x+bounds.w, 1.5, -0.5 ), 0.0001, 1);
+		//PS.qf[i] = constrainF( map( PS.cx[i], TL.bounds.x, TL.bounds.x+TL.bounds.w, 1.5, -0.5 ), 0.0001, 1);
 
 		// radial
-		//rp->quad_factor = constrainF( map( v2d_dist(rp->center, bcenter), 0, max_dist, 1.5, -0.5 ), 0.0001, 1);
+		//PS.qf[i] = constrainF( map( hypot( PS.cx[i] - bcenter.x, PS.cy[i] - bcenter.y ), 0, max_dist, 1.5, -0.5 ), 0.0001, 1);
 
 		// constant thickness:
-		//rp->quad_factor = 1 - (25 / (T.s * radii[ rp->sides ]));
+		//PS.qf[i] = 1 - (25 / (TL.T.s * radii[ PS.sides[i] ]));
 	}
 
 	//SDL_Rect screen_rct = (SDL_Rect){0,0,width,height};
@@ -920,19 +4197,130 @@ int main(int argc, char *argv[]){
 
 
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
-	SDL_Texture *AAtexture = SDL_CreateTexture( rend, SDL_PIXELFORMAT_RGBA8888, 
-												SDL_TEXTUREACCESS_TARGET,  CFG->AAx * width, CFG->AAx * height );
+	// AA_mode 1: the software rasterizer fills a window-sized frame with analytic coverage,
+	// which is streamed to a window-sized AAtexture instead of drawing into an AAx-sized one.
+	bool analytic = ( CFG->aa_mode == 1 );
+	SDL_Surface *frame = NULL;
+	SDL_Texture *AAtexture;
+	if( analytic ){
+		frame = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, SDL_PIXELFORMAT_RGBA32 );
+		AAtexture = SDL_CreateTexture( rend, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, width, height );
+		printf("anti-aliasing: analytic coverage, %d x %d\n", width, height );
+	}
+	else{
+		AAtexture = SDL_CreateTexture( rend, SDL_PIXELFORMAT_RGBA8888, 
+		                               SDL_TEXTUREACCESS_TARGET,  CFG->AAx * width, CFG->AAx * height );
+	}
 	SDL_Rect AAdst = (SDL_Rect){ 0, 0, width, height };
 
+	// frames are read back at window size: the analytic frame as is, otherwise AAtexture
+	// scaled down into capture_target the same way it is onto the window.
+	SDL_Texture *capture_target = NULL;
+	if( capture_left > 0 ){
+		if( !analytic ){
+			capture_target = SDL_CreateTexture( rend, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height );
+		}
+		if( !frame_stream_open( &FS, capture_path, width, height, capture_fps, capture_y4m ) ){
+			SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "couldn't open \"%s\" for capture", capture_path );
+			frame_stream_close( &FS );
+			return 2;
+		}
+		printf("capturing %d frames at %d fps to \"%s\" (%s)\n", capture_left, capture_fps, capture_path,
+		        capture_y4m? "y4m" : "raw rgba" );
+	}
+
 	int framecount = 0;
 
 	int dragging = 0;
 
+	thread_pool pool;
+	pool_init( &pool, CFG->threads );
+	printf("field update threads: %d\n", pool.workers + 1 );
+
+	noise_grid NG;
+	noise_grid_init( &NG, &TL.bounds, (CFG->noise_grid_cell > 0)? CFG->noise_grid_cell * CFG->AAx : TL.smallest_radius );
+	bool use_grid = CFG->noise_grid;
+	// 'g' toggles it and reports how far it is from exact sampling
+	printf("noise grid: %d x %d nodes, %g px%s\n", NG.cols, NG.rows, NG.cell, use_grid? "" : " (off)" );
+
+	quad_batch QB;
+	build_quad_batch( &QB, &PS );
+	// 'b' flips back to one gp_quadpoly() per polygon, reporting the mean frame time of the mode it leaves.
+	// The analytic rasterizer submits no geometry, so there it does nothing.
+	bool batched = 1;
+	int mode_frames = 0;
+	double mode_time = 0;
+
+	// Nothing is recomputed unless the noise parameters or the colors moved, and nothing
+	// is drawn at all while idle: the loop then blocks in SDL_WaitEvent().
+	bool field_dirty = 1;  // nx, ny or nscale changed
+	bool colors_dirty = 0; // a polygon got painted
+	bool redraw = 1;       // AAtexture must be rebuilt
+	bool present = 1;      // the window must be re-presented
+
+	// 'h' shows where the frame time goes, CFG->frame_trace logs it for every frame
+	frame_stats FT;
+	frame_stats_init( &FT );
+	if( CFG->frame_trace != NULL && CFG->frame_trace[0] != '\0' ){
+		if( frame_stats_trace( &FT, CFG->frame_trace, CFG->tesselation_code, CFG->AAx, CFG->aa_mode ) ){
+			printf("frame trace: \"%s\"\n", CFG->frame_trace );
+		}
+		else SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "couldn't open \"%s\" for the frame trace", CFG->frame_trace );
+	}
 
 	puts("<<Entering Main Loop>>");
 	while ( loop ) {//============================================================================================================
 
+		if( building && tiling_builder_take( &TB, &TL, &geo_count, &built ) ){
+			// everything indexing regpols is rebuilt: it may have moved, and the new polygons aren't in it
+			int N = ok_vec_count(&TL.regpols);
+			tiling_zones( &TL );
+			bool *visible = malloc( max( N, 1 ) * sizeof(bool) );
+			cull_to_viewport( &TL.regpols, visible, &TL.zones, &view, TL.T.s );
+			poly_store_free( &PS );
+			build_poly_store( &PS, &TL.regpols, visible, TB.TL.geov.values, geo_count );
+			free( visible );
+			quad_batch_free( &QB );
+			build_quad_batch( &QB, &PS );
+			if( CFG->noise_grid_cell <= 0 && NG.cell != TL.smallest_radius ){
+				noise_grid_free( &NG );
+				noise_grid_init( &NG, &TL.bounds, TL.smallest_radius );
+			}
+			field_dirty = 1;
+			if( !shown_first && N > 0 ){
+				printf("first %d polygons after %.1f ms\n", N, seconds_since( t_start ) * 1000 );
+				shown_first = 1;
+			}
+
+			if( built ){
+				building = 0;
+				printf("startup: config %.1f ms, catalogue %.1f ms, lattice %.1f ms, faces %.1f ms, zones %.1f ms, ready after %.1f ms\n",
+				       t_config * 1000, t_catalogue * 1000, TB.TL.t_lattice * 1000, TB.TL.t_faces * 1000, TB.TL.t_zones * 1000,
+				       seconds_since( t_start ) * 1000 );
+				printf("culling: %d polygons submitted, %d culled\n", PS.visible, PS.count - PS.visible );
+				printf("quad batch: %d faces in %d draw call(s)\n", QB.faces, (QB.faces + QUAD_BATCH_CHUNK - 1) / QUAD_BATCH_CHUNK );
+
+				float halo_radius = TL.smallest_radius * CFG->halo_radius;
+				if( CFG->halo_points > 0 ){	
+					halo_offsets = malloc( CFG->halo_points * sizeof(vec2d) );
+					float halo_alpha = TWO_PI / CFG->halo_points;
+					for (int i = 0; i < CFG->halo_points; ++i ){
+						halo_offsets[i] = v2d( halo_radius * cos(i * halo_alpha), halo_radius * sin(i * halo_alpha) );
+					}
+				}
+			}
+		}
+
+		frame_phase( &FT, PHASE_BUILD );
+
 		SDL_Event event;
+		bool idle = !( field_dirty || colors_dirty || redraw || present || (capture_left > 0 && !building) );
+		// while building, wake up now and then to pick up new polygons
+		if( idle ){
+			if( building ) SDL_WaitEventTimeout( NULL, 15 );
+			else SDL_WaitEvent( NULL );
+		}
+		frame_phase( &FT, PHASE_IDLE );
 		while( SDL_PollEvent(&event) ){
 
 			switch (event.type) {
@@ -941,6 +4329,16 @@ int main(int argc, char *argv[]){
 					break;
 
 				case SDL_RENDER_TARGETS_RESET:
+				case SDL_RENDER_DEVICE_RESET:
+					// target textures lost their contents
+					redraw = 1;
+					break;
+
+				case SDL_WINDOWEVENT:
+					if( event.window.event == SDL_WINDOWEVENT_EXPOSED ||
+						event.window.event == SDL_WINDOWEVENT_RESTORED ){
+						present = 1;
+					}
 					break;
 
 				case SDL_KEYDOWN:
@@ -955,7 +4353,35 @@ int main(int argc, char *argv[]){
 						timeinfo = localtime ( &rawtime );
 						strftime( buf, 255, "export %Y.%m.%d %H-%M-%S.svg", timeinfo );
 						printf("exporting \"%s\"!\n", buf );
-						export_svg( &regpols, buf );
+						// culled polygons are left out of the per-frame field, fill them in for the file
+						field_job FJ = { &PS, ctx, &bctx, osn_batched, nscale, nx, ny, use_grid? &NG : NULL };
+						pool_run( &pool, field_update_range, &FJ, PS.count, FIELD_ALIGN );
+						export_svg_config( CFG, &TL.regpols, PS.qf, buf );
+					}
+					else if( event.key.keysym.sym == 'b' && analytic ){
+						printf("'b' has no effect with AA_mode 1: the frame is rasterized in software\n");
+					}
+					else if( event.key.keysym.sym == 'b' ){
+						printf("%s render: %.3f ms/frame over %d frames (%d polygons submitted, %d culled)\n", 
+								batched? "batched" : "per-polygon", 1000 * mode_time / max( mode_frames, 1 ), mode_frames,
+								PS.visible, PS.count - PS.visible );
+						batched = !batched;
+						mode_frames = 0;
+						mode_time = 0;
+						redraw = 1;
+					}
+					else if( event.key.keysym.sym == 'h' ){
+						FT.hud = !FT.hud;
+						present = 1;
+					}
+					else if( event.key.keysym.sym == 'g' ){
+						use_grid = !use_grid;
+						noise_grid_update( &NG, ctx, &TL.bounds, nscale, nx, ny );
+						double max_err, mean_err;
+						noise_grid_error( &PS, &NG, ctx, nscale, nx, ny, &max_err, &mean_err );
+						printf("noise grid %s. quad_factor error vs exact: max %.5f, mean %.5f\n", 
+								use_grid? "on" : "off", max_err, mean_err );
+						field_dirty = 1;
 					}
 
 					break;
@@ -966,46 +4392,34 @@ int main(int argc, char *argv[]){
 					mouse.x = event.motion.x;
 					mouse.y = event.motion.y;
 
-					/*
 					if( pressed ){
-						paint_poly( current_paint, mouse, zones, zone_cols, CFG->AAx, &bounds, zone_iw, zone_ih );
-						vec2d delta = v2d_diff( mouse, pmouse );
-						double deltamag = v2d_mag( delta );
-						if( deltamag > halo_radius ){
-							int steps = floor(deltamag / halo_radius);
-							vec2d step = v2d_setlen( delta, halo_radius );
-							for (int s = 1; s <= steps; ++s ){
-								vec2d v = v2d_sum( pmouse, v2d_product( step, s ) );
-								paint_poly( current_paint, v, zones, zone_cols, CFG->AAx, &bounds, zone_iw, zone_ih );
-							}
-						}
+						colors_dirty |= paint_stroke( current_paint, pmouse, mouse, &TL.zones, CFG->AAx ) > 0;
 					}
-					*/
 
-					if( dragging ){
+					if( dragging && (pmouse.x != mouse.x || pmouse.y != mouse.y) ){
 						nx += 0.001 * (pmouse.x - mouse.x);
 						ny += 0.001 * (pmouse.y - mouse.y);
+						field_dirty = 1;
 					}
 
 					break;
 				case SDL_MOUSEBUTTONDOWN:
-					/*
 					if( event.button.button == SDL_BUTTON_LEFT  ){
 						bool pickingcolor = 0;
 						if( mouse.x > width - palW   &&   mouse.y > palY ){
 							for (int i = 0; i < CFG->palette_count; ++i ){
 								if( mouse.y < palY + (i+1) * palW ){
-									current_paint = palette + i;
+									current_paint = PAL.solid[i];
 									pickingcolor = 1;
 									break;
 								}
 							}
 						}
 						if( !pickingcolor ){
-							paint_poly( current_paint, mouse, zones, zone_cols, CFG->AAx, &bounds, zone_iw, zone_ih );
+							colors_dirty |= paint_poly( current_paint, mouse, &TL.zones, CFG->AAx );
 							pressed = 1;
 						}
-					}*/
+					}
 
 					if( event.button.button == SDL_BUTTON_RIGHT ){
 						dragging = 1;
@@ -1031,63 +4445,160 @@ int main(int argc, char *argv[]){
 					else{
 						nscale *= pow( 0.9, event.wheel.y );
 					}
+					field_dirty |= ( event.wheel.y != 0 );
 					break;
 			}
 		}
 
 
 		/*vec2d aam = v2d_product( mouse, 2 );
-		ok_vec_foreach_ptr(&regpols, regular_poly *rp){
-			rp->quad_factor = sq( sin( (v2d_dist( rp->center, aam ) + framecount) * 0.003 ) );
+		for (int i = 0; i < PS.count; ++i ){
+			PS.qf[i] = sq( sin( (hypot( PS.cx[i] - aam.x, PS.cy[i] - aam.y ) + framecount) * 0.003 ) );
 		}*/
 
 		//nx += 0.0001 * (mouse.x - cx);
 		//ny += 0.0001 * (mouse.y - cy);
 		//nscale = map( mouse.x, 0, width, 0.005, 0.00001 );
+
+		frame_phase( &FT, PHASE_EVENTS );
 		
+		Uint64 frame_t0 = SDL_GetPerformanceCounter();
+
+		// capture time only moves when a frame is taken, and waits for the whole tiling
+		bool capturing = ( capture_left > 0 && !building );
+		if( capturing ){
+			if( captured == 0 ) capture_t0 = frame_t0;
+			else{
+				nx += capture_drift / capture_fps;
+				field_dirty = 1;
+			}
+		}
+
 		//*
-		ok_vec_foreach_ptr(&regpols, regular_poly *rp){		
-			rp->quad_factor = open_simplex_noise2d( ctx, rp->center.x * nscale + nx, rp->center.y * nscale + ny );
-			rp->quad_factor = constrainF( rp->quad_factor + 0.5, 0.0001, 1 );
+		if( field_dirty ){
+			if( use_grid ) noise_grid_update( &NG, ctx, &TL.bounds, nscale, nx, ny );
+			field_job FJ = { &PS, ctx, &bctx, osn_batched, nscale, nx, ny, use_grid? &NG : NULL };
+			pool_run( &pool, field_update_range, &FJ, PS.visible, FIELD_ALIGN );
+			field_dirty = 0;
+			redraw = 1;
 		}//*/
+		frame_phase( &FT, PHASE_FIELD );
 
+		if( colors_dirty ){
+			quad_batch_colors( &QB, &PS );
+			colors_dirty = 0;
+			redraw = 1;
+		}
+		frame_phase( &FT, PHASE_COLORS );
 
-		SDL_SetRenderTarget( rend, AAtexture );
-		//SDL_SetRenderDraw_Uint32( rend, CFG->color_background );
-		SDL_SetRenderDrawColor( rend, 0,0,0,255 );
-		SDL_RenderClear( rend );
+		if( !redraw && !present && !capturing ) continue;
 
-		ok_vec_foreach_ptr(&regpols, regular_poly *rp){
+		if( redraw && analytic ){
+			raster_tiling_into( &pool, &TL, PS.qf, (SDL_Color){0,0,0,255}, 0, frame );
+			SDL_UpdateTexture( AAtexture, NULL, frame->pixels, frame->pitch );
+			FT.polygons += PS.visible;
+			redraw = 0;
+		}
+		if( redraw ){
+			SDL_SetRenderTarget( rend, AAtexture );
+			//SDL_SetRenderDraw_Uint32( rend, CFG->color_background );
+			SDL_SetRenderDrawColor( rend, 0,0,0,255 );
+			SDL_RenderClear( rend );
+
+			if( batched ){
+				quad_batch_job QJ = { &QB, &PS };
+				pool_run( &pool, quad_batch_job_range, &QJ, PS.visible, 1 );
+				FT.calls += quad_batch_render( rend, &QB );
+				FT.polygons += PS.visible;
+			}
+			else{
+				ok_vec_foreach_ptr(&TL.regpols, regular_poly *rp){
+
+					if( rp->id >= PS.visible ) continue;
+					//double a = atan2( rp->center.y - (2*mouse.y), rp->center.x - (2*mouse.x) );
+					//int offset = lrint( map( a, -PI, PI, rp->sides + 0.499, -0.499 ) );
+					int calls = gp_quadpoly( rend, rp, PS.qf[ rp->id ], 0 );//rp->angle
+					//, edge_color, CFG->edge_thickness
+					FT.calls += calls;
+					FT.polygons += ( calls > 0 );
+				}
+			}
 
-			//double a = atan2( rp->center.y - (2*mouse.y), rp->center.x - (2*mouse.x) );
-			//int offset = lrint( map( a, -PI, PI, rp->sides + 0.499, -0.499 ) );
-			gp_quadpoly( rend, rp, 0 );//rp->angle
-			//, edge_color, CFG->edge_thickness
+			SDL_SetRenderTarget( rend, NULL );
+			redraw = 0;
 		}
+		frame_phase( &FT, PHASE_RENDER );
 
-		SDL_SetRenderTarget( rend, NULL );
+		if( capturing ){
+			Uint8 *px = frame_stream_acquire( &FS );
+			if( analytic ){
+				for (int y = 0; y < height; ++y ){
+					memcpy( px + 4 * width * y, (Uint8*)frame->pixels + y * frame->pitch, 4 * width );
+				}
+			}
+			else{
+				SDL_SetRenderTarget( rend, capture_target );
+				SDL_RenderCopy( rend, AAtexture, NULL, NULL );
+				SDL_RenderReadPixels( rend, NULL, SDL_PIXELFORMAT_RGBA32, px, 4 * width );
+				SDL_SetRenderTarget( rend, NULL );
+			}
+			frame_stream_submit( &FS );
+			captured++;
+			if( --capture_left == 0 ) goto exit;
+		}
+		frame_phase( &FT, PHASE_CAPTURE );
 		
 		SDL_RenderCopy( rend, AAtexture, NULL, &AAdst );
 
 		//render_tela_abaulada( rend, AAtexture, &TA );
 
-		/*for (int i = 0; i < CFG->palette_count; ++i ){
+		for (int i = 0; i < CFG->palette_count; ++i ){
 			SDL_Rect dst = (SDL_Rect){ width-palW, palY + i * palW, palW, palW };
 			SDL_SetRenderDraw_SDL_Color( rend, palette + i );
 			SDL_RenderFillRect( rend, &dst );
-		}*/
+		}
+
+		if( FT.hud ) frame_stats_draw( &FT, rend, 8, 8, 2 );
+		frame_phase( &FT, PHASE_COPY );
 
 		SDL_RenderPresent(rend);
-		SDL_framerateDelay( CFG->frame_period );
+		present = 0;
+		frame_phase( &FT, PHASE_PRESENT );
+		mode_time += seconds_since( frame_t0 );
+		if( !capturing ) SDL_framerateDelay( CFG->frame_period );
+		frame_phase( &FT, PHASE_DELAY );
+		frame_stats_end( &FT );
 		framecount++;
+		mode_frames++;
 	}
 
 	exit:;
 
+	if( captured > 0 || capture_left > 0 ){
+		double t = seconds_since( capture_t0 );
+		bool ok = frame_stream_close( &FS );
+		printf("captured %d frames (%.2f s of video) in %.2f s, %.1f frames/s%s\n", captured, captured / (double)capture_fps,
+		        t, captured / max( t, 1e-9 ), ok? "" : ", WRITE FAILED" );
+		if( capture_target != NULL ) SDL_DestroyTexture( capture_target );
+	}
+
+	if( FT.csv != NULL ) printf("frame trace: %d frames written to \"%s\"\n", FT.frames, CFG->frame_trace );
+	frame_stats_close( &FT );
+
+	pool_deinit( &pool );
+	quad_batch_free( &QB );
+	noise_grid_free( &NG );
+	poly_store_free( &PS );
+	tiling_free( &TL );
+	free( halo_offsets );
+	SDL_FreeSurface( frame );
+	// joins the builder if the window was closed mid-build
+	if( started ) tiling_builder_free( &TB );
+	if( cat_open ) catalogue_close( &cat );
 	SDL_DestroyRenderer(rend);
 	SDL_DestroyWindow(window);
 
 	SDL_Quit();
 
 	return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/*
+	Small persistent pool of SDL threads for data-parallel loops.
+
+	pool_run() splits [0, count) into ranges whose boundaries are multiples of
+	`align` elements (so workers never share a cache line of the arrays they
+	write), wakes the workers and drains ranges on the calling thread too,
+	returning once every range is done. With 0 workers it just calls fn once.
+	pool_run_ranges() takes the range size as given, e.g. 1 for a few long jobs.
+*/
+
+#include <SDL.h>
+
+typedef void (*pool_fn)( void *data, int a, int b );
+
+typedef struct {
+
+	int workers; // threads besides the caller
+	SDL_Thread **threads;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	SDL_cond *done;
+	int generation;
+	int pending;
+	int quit;
+
+	pool_fn fn;
+	void *data;
+	int count;
+	int range;
+	SDL_atomic_t next;
+
+} thread_pool;
+
+static void pool_drain( thread_pool *TP ){
+	while( 1 ){
+		int a = SDL_AtomicAdd( &TP->next, TP->range );
+		if( a >= TP->count ) break;
+		int b = a + TP->range;
+		if( b > TP->count ) b = TP->count;
+		TP->fn( TP->data, a, b );
+	}
+}
+
+static int pool_worker( void *arg ){
+	thread_pool *TP = arg;
+	int seen = 0;
+	SDL_LockMutex( TP->lock );
+	while( 1 ){
+		while( !TP->quit && TP->generation == seen ) SDL_CondWait( TP->wake, TP->lock );
+		if( TP->quit ) break;
+		seen = TP->generation;
+		SDL_UnlockMutex( TP->lock );
+		pool_drain( TP );
+		SDL_LockMutex( TP->lock );
+		if( --TP->pending == 0 ) SDL_CondSignal( TP->done );
+	}
+	SDL_UnlockMutex( TP->lock );
+	return 0;
+}
+
+// threads <= 0 means one per logical CPU, 1 means serial (no worker threads at all).
+static void pool_init( thread_pool *TP, int threads ){
+	if( threads <= 0 ) threads = SDL_GetCPUCount();
+	if( threads < 1 ) threads = 1;
+	TP->workers = threads - 1;
+	TP->generation = 0;
+	TP->pending = 0;
+	TP->quit = 0;
+	TP->threads = NULL;
+	if( TP->workers == 0 ) return;
+
+	TP->lock = SDL_CreateMutex();
+	TP->wake = SDL_CreateCond();
+	TP->done = SDL_CreateCond();
+	TP->threads = malloc( TP->workers * sizeof(SDL_Thread*) );
+	for (int i = 0; i < TP->workers; ++i ){
+		TP->threads[i] = SDL_CreateThread( pool_worker, "pool worker", TP );
+		if( TP->threads[i] == NULL ){
+			SDL_LogError( SDL_LOG_CATEGORY_APPLICATION, "SDL_CreateThread error: %s", SDL_GetError() );
+			TP->workers = i;
+			break;
+		}
+	}
+}
+
+static void pool_run_ranges( thread_pool *TP, pool_fn fn, void *data, int count, int range ){
+	if( count <= 0 ) return;
+	if( range < 1 ) range = 1;
+	if( TP->workers == 0 || range >= count ){
+		fn( data, 0, count );
+		return;
+	}
+	SDL_LockMutex( TP->lock );
+	TP->fn = fn;
+	TP->data = data;
+	TP->count = count;
+	TP->range = range;
+	SDL_AtomicSet( &TP->next, 0 );
+	TP->pending = TP->workers;
+	TP->generation++;
+	SDL_CondBroadcast( TP->wake );
+	SDL_UnlockMutex( TP->lock );
+
+	pool_drain( TP );
+
+	SDL_LockMutex( TP->lock );
+	while( TP->pending > 0 ) SDL_CondWait( TP->done, TP->lock );
+	SDL_UnlockMutex( TP->lock );
+}
+
+static void pool_run( thread_pool *TP, pool_fn fn, void *data, int count, int align ){
+	int threads = TP->workers + 1;
+	// a few ranges per thread so uneven ranges balance out
+	int range = (count + 4*threads - 1) / (4*threads);
+	if( align > 1 ) range = ((range + align - 1) / align) * align;
+	pool_run_ranges( TP, fn, data, count, range );
+}
+
+static void pool_deinit( thread_pool *TP ){
+	// threads is set even when every SDL_CreateThread() failed and left 0 workers
+	if( TP->threads == NULL ) return;
+	SDL_LockMutex( TP->lock );
+	TP->quit = 1;
+	SDL_CondBroadcast( TP->wake );
+	SDL_UnlockMutex( TP->lock );
+	for (int i = 0; i < TP->workers; ++i ){
+		SDL_WaitThread( TP->threads[i], NULL );
+	}
+	free( TP->threads );
+	SDL_DestroyCond( TP->wake );
+	SDL_DestroyCond( TP->done );
+	SDL_DestroyMutex( TP->lock );
+	TP->threads = NULL;
+	TP->workers = 0;
+}
+
+#endif